@@ -0,0 +1,749 @@
+/* A self-contained C API in the style of a graphics library: many
+   enums, opaque handles, descriptor structs, callbacks, and object
+   macros.  No system headers, so results are comparable across
+   machines. */
+
+#ifndef GFX_H
+#define GFX_H
+
+#define GFX_VERSION_MAJOR 3
+#define GFX_VERSION_MINOR 14
+#define GFX_VERSION_PATCH 2
+#define GFX_VERSION ((GFX_VERSION_MAJOR << 16) | (GFX_VERSION_MINOR << 8) | GFX_VERSION_PATCH)
+
+#define GFX_MAX_COLOR_ATTACHMENTS 8
+#define GFX_MAX_VERTEX_BUFFERS 16
+#define GFX_MAX_VERTEX_ATTRIBUTES 32
+#define GFX_MAX_BIND_GROUPS 4
+#define GFX_MAX_BINDINGS_PER_GROUP 64
+#define GFX_MAX_MIP_LEVELS 16
+#define GFX_WHOLE_SIZE (~0ULL)
+#define GFX_INVALID_INDEX 0xffffffffu
+#define GFX_DEFAULT_TIMEOUT_NS 1000000000ull
+#define GFX_PI 3.14159265358979323846
+#define GFX_NAME "gfx"
+#define GFX_FLAG(n) (1u << (n))
+
+typedef unsigned char gfx_u8;
+typedef unsigned short gfx_u16;
+typedef unsigned int gfx_u32;
+typedef unsigned long long gfx_u64;
+typedef signed int gfx_i32;
+typedef signed long long gfx_i64;
+typedef float gfx_f32;
+typedef double gfx_f64;
+typedef gfx_u32 gfx_bool;
+typedef gfx_u64 gfx_size;
+typedef gfx_u32 gfx_flags;
+
+typedef struct gfx_instance_t* gfx_instance;
+typedef struct gfx_adapter_t* gfx_adapter;
+typedef struct gfx_device_t* gfx_device;
+typedef struct gfx_queue_t* gfx_queue;
+typedef struct gfx_surface_t* gfx_surface;
+typedef struct gfx_swapchain_t* gfx_swapchain;
+typedef struct gfx_buffer_t* gfx_buffer;
+typedef struct gfx_texture_t* gfx_texture;
+typedef struct gfx_texture_view_t* gfx_texture_view;
+typedef struct gfx_sampler_t* gfx_sampler;
+typedef struct gfx_shader_t* gfx_shader;
+typedef struct gfx_bind_group_layout_t* gfx_bind_group_layout;
+typedef struct gfx_bind_group_t* gfx_bind_group;
+typedef struct gfx_pipeline_layout_t* gfx_pipeline_layout;
+typedef struct gfx_render_pipeline_t* gfx_render_pipeline;
+typedef struct gfx_compute_pipeline_t* gfx_compute_pipeline;
+typedef struct gfx_command_encoder_t* gfx_command_encoder;
+typedef struct gfx_render_pass_t* gfx_render_pass;
+typedef struct gfx_compute_pass_t* gfx_compute_pass;
+typedef struct gfx_command_buffer_t* gfx_command_buffer;
+typedef struct gfx_query_set_t* gfx_query_set;
+typedef struct gfx_fence_t* gfx_fence;
+
+typedef enum gfx_result {
+    GFX_SUCCESS = 0,
+    GFX_NOT_READY = 1,
+    GFX_TIMEOUT = 2,
+    GFX_INCOMPLETE = 3,
+    GFX_ERROR_OUT_OF_HOST_MEMORY = -1,
+    GFX_ERROR_OUT_OF_DEVICE_MEMORY = -2,
+    GFX_ERROR_INITIALIZATION_FAILED = -3,
+    GFX_ERROR_DEVICE_LOST = -4,
+    GFX_ERROR_INVALID_ARGUMENT = -5,
+    GFX_ERROR_UNSUPPORTED = -6,
+    GFX_ERROR_SURFACE_LOST = -7,
+    GFX_ERROR_OUT_OF_DATE = -8,
+    GFX_ERROR_VALIDATION = -9,
+    GFX_ERROR_UNKNOWN = -100
+} gfx_result;
+
+typedef enum gfx_backend {
+    GFX_BACKEND_NULL,
+    GFX_BACKEND_VULKAN,
+    GFX_BACKEND_METAL,
+    GFX_BACKEND_D3D12,
+    GFX_BACKEND_D3D11,
+    GFX_BACKEND_OPENGL,
+    GFX_BACKEND_OPENGLES,
+    GFX_BACKEND_WEBGPU,
+    GFX_BACKEND_COUNT
+} gfx_backend;
+
+typedef enum gfx_texture_format {
+    GFX_FORMAT_UNDEFINED,
+    GFX_FORMAT_R8_UNORM,
+    GFX_FORMAT_R8_SNORM,
+    GFX_FORMAT_R8_UINT,
+    GFX_FORMAT_R8_SINT,
+    GFX_FORMAT_R16_UINT,
+    GFX_FORMAT_R16_SINT,
+    GFX_FORMAT_R16_FLOAT,
+    GFX_FORMAT_RG8_UNORM,
+    GFX_FORMAT_RG8_SNORM,
+    GFX_FORMAT_RG8_UINT,
+    GFX_FORMAT_RG8_SINT,
+    GFX_FORMAT_R32_UINT,
+    GFX_FORMAT_R32_SINT,
+    GFX_FORMAT_R32_FLOAT,
+    GFX_FORMAT_RG16_UINT,
+    GFX_FORMAT_RG16_SINT,
+    GFX_FORMAT_RG16_FLOAT,
+    GFX_FORMAT_RGBA8_UNORM,
+    GFX_FORMAT_RGBA8_UNORM_SRGB,
+    GFX_FORMAT_RGBA8_SNORM,
+    GFX_FORMAT_RGBA8_UINT,
+    GFX_FORMAT_RGBA8_SINT,
+    GFX_FORMAT_BGRA8_UNORM,
+    GFX_FORMAT_BGRA8_UNORM_SRGB,
+    GFX_FORMAT_RGB10A2_UNORM,
+    GFX_FORMAT_RG11B10_FLOAT,
+    GFX_FORMAT_RGB9E5_FLOAT,
+    GFX_FORMAT_RG32_UINT,
+    GFX_FORMAT_RG32_SINT,
+    GFX_FORMAT_RG32_FLOAT,
+    GFX_FORMAT_RGBA16_UINT,
+    GFX_FORMAT_RGBA16_SINT,
+    GFX_FORMAT_RGBA16_FLOAT,
+    GFX_FORMAT_RGBA32_UINT,
+    GFX_FORMAT_RGBA32_SINT,
+    GFX_FORMAT_RGBA32_FLOAT,
+    GFX_FORMAT_STENCIL8,
+    GFX_FORMAT_DEPTH16_UNORM,
+    GFX_FORMAT_DEPTH24_PLUS,
+    GFX_FORMAT_DEPTH24_PLUS_STENCIL8,
+    GFX_FORMAT_DEPTH32_FLOAT,
+    GFX_FORMAT_DEPTH32_FLOAT_STENCIL8,
+    GFX_FORMAT_BC1_RGBA_UNORM,
+    GFX_FORMAT_BC1_RGBA_UNORM_SRGB,
+    GFX_FORMAT_BC2_RGBA_UNORM,
+    GFX_FORMAT_BC2_RGBA_UNORM_SRGB,
+    GFX_FORMAT_BC3_RGBA_UNORM,
+    GFX_FORMAT_BC3_RGBA_UNORM_SRGB,
+    GFX_FORMAT_BC4_R_UNORM,
+    GFX_FORMAT_BC4_R_SNORM,
+    GFX_FORMAT_BC5_RG_UNORM,
+    GFX_FORMAT_BC5_RG_SNORM,
+    GFX_FORMAT_BC6H_RGB_UFLOAT,
+    GFX_FORMAT_BC6H_RGB_FLOAT,
+    GFX_FORMAT_BC7_RGBA_UNORM,
+    GFX_FORMAT_BC7_RGBA_UNORM_SRGB,
+    GFX_FORMAT_ETC2_RGB8_UNORM,
+    GFX_FORMAT_ETC2_RGB8A1_UNORM,
+    GFX_FORMAT_ETC2_RGBA8_UNORM,
+    GFX_FORMAT_ASTC_4X4_UNORM,
+    GFX_FORMAT_ASTC_8X8_UNORM,
+    GFX_FORMAT_COUNT
+} gfx_texture_format;
+
+typedef enum gfx_vertex_format {
+    GFX_VERTEX_UINT8X2 = 1,
+    GFX_VERTEX_UINT8X4,
+    GFX_VERTEX_SINT8X2,
+    GFX_VERTEX_SINT8X4,
+    GFX_VERTEX_UNORM8X2,
+    GFX_VERTEX_UNORM8X4,
+    GFX_VERTEX_SNORM8X2,
+    GFX_VERTEX_SNORM8X4,
+    GFX_VERTEX_UINT16X2,
+    GFX_VERTEX_UINT16X4,
+    GFX_VERTEX_FLOAT16X2,
+    GFX_VERTEX_FLOAT16X4,
+    GFX_VERTEX_FLOAT32,
+    GFX_VERTEX_FLOAT32X2,
+    GFX_VERTEX_FLOAT32X3,
+    GFX_VERTEX_FLOAT32X4,
+    GFX_VERTEX_UINT32,
+    GFX_VERTEX_UINT32X2,
+    GFX_VERTEX_UINT32X3,
+    GFX_VERTEX_UINT32X4
+} gfx_vertex_format;
+
+typedef enum gfx_buffer_usage {
+    GFX_BUFFER_USAGE_MAP_READ = GFX_FLAG(0),
+    GFX_BUFFER_USAGE_MAP_WRITE = GFX_FLAG(1),
+    GFX_BUFFER_USAGE_COPY_SRC = GFX_FLAG(2),
+    GFX_BUFFER_USAGE_COPY_DST = GFX_FLAG(3),
+    GFX_BUFFER_USAGE_INDEX = GFX_FLAG(4),
+    GFX_BUFFER_USAGE_VERTEX = GFX_FLAG(5),
+    GFX_BUFFER_USAGE_UNIFORM = GFX_FLAG(6),
+    GFX_BUFFER_USAGE_STORAGE = GFX_FLAG(7),
+    GFX_BUFFER_USAGE_INDIRECT = GFX_FLAG(8),
+    GFX_BUFFER_USAGE_QUERY_RESOLVE = GFX_FLAG(9)
+} gfx_buffer_usage;
+
+typedef enum gfx_texture_usage {
+    GFX_TEXTURE_USAGE_COPY_SRC = GFX_FLAG(0),
+    GFX_TEXTURE_USAGE_COPY_DST = GFX_FLAG(1),
+    GFX_TEXTURE_USAGE_SAMPLED = GFX_FLAG(2),
+    GFX_TEXTURE_USAGE_STORAGE = GFX_FLAG(3),
+    GFX_TEXTURE_USAGE_RENDER_ATTACHMENT = GFX_FLAG(4)
+} gfx_texture_usage;
+
+typedef enum gfx_shader_stage {
+    GFX_STAGE_NONE = 0,
+    GFX_STAGE_VERTEX = GFX_FLAG(0),
+    GFX_STAGE_FRAGMENT = GFX_FLAG(1),
+    GFX_STAGE_COMPUTE = GFX_FLAG(2),
+    GFX_STAGE_ALL = GFX_STAGE_VERTEX | GFX_STAGE_FRAGMENT | GFX_STAGE_COMPUTE
+} gfx_shader_stage;
+
+typedef enum gfx_primitive_topology {
+    GFX_TOPOLOGY_POINT_LIST,
+    GFX_TOPOLOGY_LINE_LIST,
+    GFX_TOPOLOGY_LINE_STRIP,
+    GFX_TOPOLOGY_TRIANGLE_LIST,
+    GFX_TOPOLOGY_TRIANGLE_STRIP
+} gfx_primitive_topology;
+
+typedef enum gfx_compare_function {
+    GFX_COMPARE_NEVER,
+    GFX_COMPARE_LESS,
+    GFX_COMPARE_EQUAL,
+    GFX_COMPARE_LESS_EQUAL,
+    GFX_COMPARE_GREATER,
+    GFX_COMPARE_NOT_EQUAL,
+    GFX_COMPARE_GREATER_EQUAL,
+    GFX_COMPARE_ALWAYS
+} gfx_compare_function;
+
+typedef enum gfx_blend_factor {
+    GFX_BLEND_ZERO,
+    GFX_BLEND_ONE,
+    GFX_BLEND_SRC,
+    GFX_BLEND_ONE_MINUS_SRC,
+    GFX_BLEND_SRC_ALPHA,
+    GFX_BLEND_ONE_MINUS_SRC_ALPHA,
+    GFX_BLEND_DST,
+    GFX_BLEND_ONE_MINUS_DST,
+    GFX_BLEND_DST_ALPHA,
+    GFX_BLEND_ONE_MINUS_DST_ALPHA,
+    GFX_BLEND_SRC_ALPHA_SATURATED,
+    GFX_BLEND_CONSTANT,
+    GFX_BLEND_ONE_MINUS_CONSTANT
+} gfx_blend_factor;
+
+typedef enum gfx_blend_operation {
+    GFX_BLEND_OP_ADD,
+    GFX_BLEND_OP_SUBTRACT,
+    GFX_BLEND_OP_REVERSE_SUBTRACT,
+    GFX_BLEND_OP_MIN,
+    GFX_BLEND_OP_MAX
+} gfx_blend_operation;
+
+typedef enum gfx_load_op { GFX_LOAD_OP_LOAD, GFX_LOAD_OP_CLEAR, GFX_LOAD_OP_DONT_CARE } gfx_load_op;
+typedef enum gfx_store_op { GFX_STORE_OP_STORE, GFX_STORE_OP_DISCARD } gfx_store_op;
+typedef enum gfx_filter { GFX_FILTER_NEAREST, GFX_FILTER_LINEAR } gfx_filter;
+typedef enum gfx_address_mode {
+    GFX_ADDRESS_REPEAT,
+    GFX_ADDRESS_MIRROR_REPEAT,
+    GFX_ADDRESS_CLAMP_TO_EDGE,
+    GFX_ADDRESS_CLAMP_TO_BORDER
+} gfx_address_mode;
+
+typedef enum gfx_log_level {
+    GFX_LOG_TRACE,
+    GFX_LOG_DEBUG,
+    GFX_LOG_INFO,
+    GFX_LOG_WARN,
+    GFX_LOG_ERROR
+} gfx_log_level;
+
+typedef struct gfx_color {
+    gfx_f64 r, g, b, a;
+} gfx_color;
+
+typedef struct gfx_extent3d {
+    gfx_u32 width;
+    gfx_u32 height;
+    gfx_u32 depth_or_layers;
+} gfx_extent3d;
+
+typedef struct gfx_origin3d {
+    gfx_u32 x, y, z;
+} gfx_origin3d;
+
+typedef struct gfx_viewport {
+    gfx_f32 x, y, width, height;
+    gfx_f32 min_depth, max_depth;
+} gfx_viewport;
+
+typedef struct gfx_rect {
+    gfx_i32 x, y;
+    gfx_u32 width, height;
+} gfx_rect;
+
+typedef void (*gfx_log_callback)(gfx_log_level level, const char* message, void* user_data);
+typedef void* (*gfx_alloc_callback)(gfx_size size, gfx_size alignment, void* user_data);
+typedef void* (*gfx_realloc_callback)(void* ptr, gfx_size size, gfx_size alignment, void* user_data);
+typedef void (*gfx_free_callback)(void* ptr, void* user_data);
+typedef void (*gfx_map_callback)(gfx_result result, void* user_data);
+typedef void (*gfx_device_lost_callback)(gfx_device device, const char* reason, void* user_data);
+typedef void (*gfx_work_done_callback)(gfx_result result, void* user_data);
+
+typedef struct gfx_allocator {
+    gfx_alloc_callback alloc;
+    gfx_realloc_callback realloc;
+    gfx_free_callback free;
+    void* user_data;
+} gfx_allocator;
+
+typedef struct gfx_instance_desc {
+    const char* application_name;
+    gfx_u32 application_version;
+    gfx_backend preferred_backend;
+    gfx_bool enable_validation;
+    gfx_bool enable_debug_labels;
+    const gfx_allocator* allocator;
+    gfx_log_callback log_callback;
+    void* log_user_data;
+} gfx_instance_desc;
+
+typedef struct gfx_adapter_limits {
+    gfx_u32 max_texture_dimension_1d;
+    gfx_u32 max_texture_dimension_2d;
+    gfx_u32 max_texture_dimension_3d;
+    gfx_u32 max_texture_array_layers;
+    gfx_u32 max_bind_groups;
+    gfx_u32 max_bindings_per_bind_group;
+    gfx_u32 max_dynamic_uniform_buffers_per_pipeline_layout;
+    gfx_u32 max_dynamic_storage_buffers_per_pipeline_layout;
+    gfx_u32 max_sampled_textures_per_shader_stage;
+    gfx_u32 max_samplers_per_shader_stage;
+    gfx_u32 max_storage_buffers_per_shader_stage;
+    gfx_u32 max_storage_textures_per_shader_stage;
+    gfx_u32 max_uniform_buffers_per_shader_stage;
+    gfx_u64 max_uniform_buffer_binding_size;
+    gfx_u64 max_storage_buffer_binding_size;
+    gfx_u32 min_uniform_buffer_offset_alignment;
+    gfx_u32 min_storage_buffer_offset_alignment;
+    gfx_u32 max_vertex_buffers;
+    gfx_u64 max_buffer_size;
+    gfx_u32 max_vertex_attributes;
+    gfx_u32 max_vertex_buffer_array_stride;
+    gfx_u32 max_color_attachments;
+    gfx_u32 max_compute_workgroup_storage_size;
+    gfx_u32 max_compute_invocations_per_workgroup;
+    gfx_u32 max_compute_workgroup_size[3];
+    gfx_u32 max_compute_workgroups_per_dimension;
+} gfx_adapter_limits;
+
+typedef struct gfx_adapter_info {
+    char name[256];
+    char driver[256];
+    gfx_u32 vendor_id;
+    gfx_u32 device_id;
+    gfx_backend backend;
+    enum { GFX_ADAPTER_DISCRETE, GFX_ADAPTER_INTEGRATED, GFX_ADAPTER_CPU, GFX_ADAPTER_UNKNOWN } type;
+    gfx_adapter_limits limits;
+} gfx_adapter_info;
+
+typedef struct gfx_device_desc {
+    const char* label;
+    gfx_flags required_features;
+    const gfx_adapter_limits* required_limits;
+    gfx_device_lost_callback device_lost;
+    void* device_lost_user_data;
+} gfx_device_desc;
+
+typedef struct gfx_buffer_desc {
+    const char* label;
+    gfx_size size;
+    gfx_flags usage;
+    gfx_bool mapped_at_creation;
+} gfx_buffer_desc;
+
+typedef struct gfx_texture_desc {
+    const char* label;
+    gfx_extent3d size;
+    gfx_u32 mip_level_count;
+    gfx_u32 sample_count;
+    enum { GFX_TEXTURE_1D, GFX_TEXTURE_2D, GFX_TEXTURE_3D } dimension;
+    gfx_texture_format format;
+    gfx_flags usage;
+    gfx_u32 view_format_count;
+    const gfx_texture_format* view_formats;
+} gfx_texture_desc;
+
+typedef struct gfx_texture_view_desc {
+    const char* label;
+    gfx_texture_format format;
+    gfx_u32 base_mip_level;
+    gfx_u32 mip_level_count;
+    gfx_u32 base_array_layer;
+    gfx_u32 array_layer_count;
+    enum { GFX_ASPECT_ALL, GFX_ASPECT_STENCIL_ONLY, GFX_ASPECT_DEPTH_ONLY } aspect;
+} gfx_texture_view_desc;
+
+typedef struct gfx_sampler_desc {
+    const char* label;
+    gfx_address_mode address_u, address_v, address_w;
+    gfx_filter mag_filter, min_filter, mipmap_filter;
+    gfx_f32 lod_min_clamp, lod_max_clamp;
+    gfx_compare_function compare;
+    gfx_u16 max_anisotropy;
+    gfx_color border_color;
+} gfx_sampler_desc;
+
+typedef struct gfx_shader_desc {
+    const char* label;
+    enum { GFX_SHADER_SPIRV, GFX_SHADER_WGSL, GFX_SHADER_MSL, GFX_SHADER_DXIL } kind;
+    union {
+        struct {
+            const gfx_u32* code;
+            gfx_size word_count;
+        } spirv;
+        struct {
+            const char* source;
+        } text;
+        struct {
+            const void* bytecode;
+            gfx_size size;
+        } binary;
+    } u;
+} gfx_shader_desc;
+
+typedef struct gfx_bind_group_layout_entry {
+    gfx_u32 binding;
+    gfx_flags visibility;
+    enum {
+        GFX_BINDING_UNIFORM_BUFFER,
+        GFX_BINDING_STORAGE_BUFFER,
+        GFX_BINDING_READONLY_STORAGE_BUFFER,
+        GFX_BINDING_SAMPLER,
+        GFX_BINDING_COMPARISON_SAMPLER,
+        GFX_BINDING_SAMPLED_TEXTURE,
+        GFX_BINDING_STORAGE_TEXTURE
+    } type;
+    gfx_bool has_dynamic_offset;
+    gfx_size min_binding_size;
+    gfx_texture_format storage_format;
+} gfx_bind_group_layout_entry;
+
+typedef struct gfx_bind_group_layout_desc {
+    const char* label;
+    gfx_u32 entry_count;
+    const gfx_bind_group_layout_entry* entries;
+} gfx_bind_group_layout_desc;
+
+typedef struct gfx_bind_group_entry {
+    gfx_u32 binding;
+    gfx_buffer buffer;
+    gfx_size offset;
+    gfx_size size;
+    gfx_sampler sampler;
+    gfx_texture_view texture_view;
+} gfx_bind_group_entry;
+
+typedef struct gfx_bind_group_desc {
+    const char* label;
+    gfx_bind_group_layout layout;
+    gfx_u32 entry_count;
+    const gfx_bind_group_entry* entries;
+} gfx_bind_group_desc;
+
+typedef struct gfx_pipeline_layout_desc {
+    const char* label;
+    gfx_u32 bind_group_layout_count;
+    const gfx_bind_group_layout* bind_group_layouts;
+    gfx_u32 push_constant_size;
+} gfx_pipeline_layout_desc;
+
+typedef struct gfx_vertex_attribute {
+    gfx_vertex_format format;
+    gfx_u64 offset;
+    gfx_u32 shader_location;
+} gfx_vertex_attribute;
+
+typedef struct gfx_vertex_buffer_layout {
+    gfx_u64 array_stride;
+    enum { GFX_STEP_VERTEX, GFX_STEP_INSTANCE } step_mode;
+    gfx_u32 attribute_count;
+    const gfx_vertex_attribute* attributes;
+} gfx_vertex_buffer_layout;
+
+typedef struct gfx_blend_component {
+    gfx_blend_operation operation;
+    gfx_blend_factor src_factor;
+    gfx_blend_factor dst_factor;
+} gfx_blend_component;
+
+typedef struct gfx_color_target_state {
+    gfx_texture_format format;
+    gfx_bool blend_enabled;
+    gfx_blend_component color;
+    gfx_blend_component alpha;
+    gfx_u8 write_mask;
+} gfx_color_target_state;
+
+typedef struct gfx_stencil_face_state {
+    gfx_compare_function compare;
+    enum {
+        GFX_STENCIL_KEEP,
+        GFX_STENCIL_ZERO,
+        GFX_STENCIL_REPLACE,
+        GFX_STENCIL_INVERT,
+        GFX_STENCIL_INCREMENT_CLAMP,
+        GFX_STENCIL_DECREMENT_CLAMP,
+        GFX_STENCIL_INCREMENT_WRAP,
+        GFX_STENCIL_DECREMENT_WRAP
+    } fail_op, depth_fail_op, pass_op;
+} gfx_stencil_face_state;
+
+typedef struct gfx_depth_stencil_state {
+    gfx_texture_format format;
+    gfx_bool depth_write_enabled;
+    gfx_compare_function depth_compare;
+    gfx_stencil_face_state stencil_front;
+    gfx_stencil_face_state stencil_back;
+    gfx_u32 stencil_read_mask;
+    gfx_u32 stencil_write_mask;
+    gfx_i32 depth_bias;
+    gfx_f32 depth_bias_slope_scale;
+    gfx_f32 depth_bias_clamp;
+} gfx_depth_stencil_state;
+
+typedef struct gfx_render_pipeline_desc {
+    const char* label;
+    gfx_pipeline_layout layout;
+    struct {
+        gfx_shader module;
+        const char* entry_point;
+        gfx_u32 buffer_count;
+        const gfx_vertex_buffer_layout* buffers;
+    } vertex;
+    struct {
+        gfx_primitive_topology topology;
+        enum { GFX_CULL_NONE, GFX_CULL_FRONT, GFX_CULL_BACK } cull_mode;
+        enum { GFX_FRONT_CCW, GFX_FRONT_CW } front_face;
+        gfx_bool unclipped_depth;
+    } primitive;
+    const gfx_depth_stencil_state* depth_stencil;
+    struct {
+        gfx_u32 count;
+        gfx_u32 mask;
+        gfx_bool alpha_to_coverage_enabled;
+    } multisample;
+    struct {
+        gfx_shader module;
+        const char* entry_point;
+        gfx_u32 target_count;
+        const gfx_color_target_state* targets;
+    } const* fragment;
+} gfx_render_pipeline_desc;
+
+typedef struct gfx_compute_pipeline_desc {
+    const char* label;
+    gfx_pipeline_layout layout;
+    gfx_shader module;
+    const char* entry_point;
+} gfx_compute_pipeline_desc;
+
+typedef struct gfx_render_pass_color_attachment {
+    gfx_texture_view view;
+    gfx_texture_view resolve_target;
+    gfx_load_op load_op;
+    gfx_store_op store_op;
+    gfx_color clear_value;
+} gfx_render_pass_color_attachment;
+
+typedef struct gfx_render_pass_depth_stencil_attachment {
+    gfx_texture_view view;
+    gfx_load_op depth_load_op;
+    gfx_store_op depth_store_op;
+    gfx_f32 depth_clear_value;
+    gfx_bool depth_read_only;
+    gfx_load_op stencil_load_op;
+    gfx_store_op stencil_store_op;
+    gfx_u32 stencil_clear_value;
+    gfx_bool stencil_read_only;
+} gfx_render_pass_depth_stencil_attachment;
+
+typedef struct gfx_render_pass_desc {
+    const char* label;
+    gfx_u32 color_attachment_count;
+    gfx_render_pass_color_attachment color_attachments[GFX_MAX_COLOR_ATTACHMENTS];
+    const gfx_render_pass_depth_stencil_attachment* depth_stencil_attachment;
+    gfx_query_set occlusion_query_set;
+} gfx_render_pass_desc;
+
+typedef struct gfx_image_copy_texture {
+    gfx_texture texture;
+    gfx_u32 mip_level;
+    gfx_origin3d origin;
+} gfx_image_copy_texture;
+
+typedef struct gfx_image_copy_buffer {
+    gfx_buffer buffer;
+    gfx_u64 offset;
+    gfx_u32 bytes_per_row;
+    gfx_u32 rows_per_image;
+} gfx_image_copy_buffer;
+
+typedef struct gfx_swapchain_desc {
+    const char* label;
+    gfx_texture_format format;
+    gfx_flags usage;
+    gfx_u32 width;
+    gfx_u32 height;
+    enum { GFX_PRESENT_FIFO, GFX_PRESENT_MAILBOX, GFX_PRESENT_IMMEDIATE } present_mode;
+} gfx_swapchain_desc;
+
+typedef struct gfx_stats {
+    gfx_u64 frame_index;
+    gfx_u64 bytes_allocated[4];
+    gfx_u32 draw_calls;
+    gfx_u32 dispatches;
+    gfx_u32 pipeline_switches;
+    gfx_u32 bind_group_switches;
+    gfx_f64 gpu_time_ms;
+    gfx_f64 cpu_time_ms;
+} gfx_stats;
+
+/* Instance and adapters */
+gfx_result gfx_create_instance(const gfx_instance_desc* desc, gfx_instance* out);
+void gfx_destroy_instance(gfx_instance instance);
+gfx_u32 gfx_enumerate_adapters(gfx_instance instance, gfx_adapter* adapters, gfx_u32 capacity);
+void gfx_adapter_get_info(gfx_adapter adapter, gfx_adapter_info* info);
+gfx_bool gfx_adapter_has_feature(gfx_adapter adapter, gfx_u32 feature);
+gfx_bool gfx_adapter_supports_format(gfx_adapter adapter, gfx_texture_format format, gfx_flags usage);
+gfx_result gfx_create_surface_xlib(gfx_instance instance, void* display, unsigned long window, gfx_surface* out);
+gfx_result gfx_create_surface_wayland(gfx_instance instance, void* display, void* surface, gfx_surface* out);
+gfx_result gfx_create_surface_win32(gfx_instance instance, void* hinstance, void* hwnd, gfx_surface* out);
+gfx_result gfx_create_surface_metal(gfx_instance instance, void* layer, gfx_surface* out);
+void gfx_destroy_surface(gfx_surface surface);
+
+/* Devices */
+gfx_result gfx_create_device(gfx_adapter adapter, const gfx_device_desc* desc, gfx_device* out);
+void gfx_destroy_device(gfx_device device);
+gfx_queue gfx_device_get_queue(gfx_device device);
+void gfx_device_get_limits(gfx_device device, gfx_adapter_limits* limits);
+void gfx_device_get_stats(gfx_device device, gfx_stats* stats);
+void gfx_device_poll(gfx_device device, gfx_bool wait);
+void gfx_device_push_error_scope(gfx_device device, gfx_u32 filter);
+gfx_result gfx_device_pop_error_scope(gfx_device device, char* message, gfx_size capacity);
+void gfx_device_set_label(gfx_device device, const char* label);
+
+/* Resources */
+gfx_result gfx_create_buffer(gfx_device device, const gfx_buffer_desc* desc, gfx_buffer* out);
+void gfx_destroy_buffer(gfx_buffer buffer);
+gfx_size gfx_buffer_get_size(gfx_buffer buffer);
+gfx_flags gfx_buffer_get_usage(gfx_buffer buffer);
+void gfx_buffer_map_async(gfx_buffer buffer, gfx_flags mode, gfx_size offset, gfx_size size, gfx_map_callback callback, void* user_data);
+void* gfx_buffer_get_mapped_range(gfx_buffer buffer, gfx_size offset, gfx_size size);
+const void* gfx_buffer_get_const_mapped_range(gfx_buffer buffer, gfx_size offset, gfx_size size);
+void gfx_buffer_unmap(gfx_buffer buffer);
+gfx_result gfx_create_texture(gfx_device device, const gfx_texture_desc* desc, gfx_texture* out);
+void gfx_destroy_texture(gfx_texture texture);
+gfx_extent3d gfx_texture_get_size(gfx_texture texture);
+gfx_texture_format gfx_texture_get_format(gfx_texture texture);
+gfx_result gfx_create_texture_view(gfx_texture texture, const gfx_texture_view_desc* desc, gfx_texture_view* out);
+void gfx_destroy_texture_view(gfx_texture_view view);
+gfx_result gfx_create_sampler(gfx_device device, const gfx_sampler_desc* desc, gfx_sampler* out);
+void gfx_destroy_sampler(gfx_sampler sampler);
+gfx_result gfx_create_shader(gfx_device device, const gfx_shader_desc* desc, gfx_shader* out);
+void gfx_destroy_shader(gfx_shader shader);
+gfx_result gfx_create_query_set(gfx_device device, gfx_u32 type, gfx_u32 count, gfx_query_set* out);
+void gfx_destroy_query_set(gfx_query_set set);
+
+/* Pipelines */
+gfx_result gfx_create_bind_group_layout(gfx_device device, const gfx_bind_group_layout_desc* desc, gfx_bind_group_layout* out);
+void gfx_destroy_bind_group_layout(gfx_bind_group_layout layout);
+gfx_result gfx_create_bind_group(gfx_device device, const gfx_bind_group_desc* desc, gfx_bind_group* out);
+void gfx_destroy_bind_group(gfx_bind_group group);
+gfx_result gfx_create_pipeline_layout(gfx_device device, const gfx_pipeline_layout_desc* desc, gfx_pipeline_layout* out);
+void gfx_destroy_pipeline_layout(gfx_pipeline_layout layout);
+gfx_result gfx_create_render_pipeline(gfx_device device, const gfx_render_pipeline_desc* desc, gfx_render_pipeline* out);
+void gfx_destroy_render_pipeline(gfx_render_pipeline pipeline);
+gfx_result gfx_create_compute_pipeline(gfx_device device, const gfx_compute_pipeline_desc* desc, gfx_compute_pipeline* out);
+void gfx_destroy_compute_pipeline(gfx_compute_pipeline pipeline);
+gfx_bind_group_layout gfx_render_pipeline_get_bind_group_layout(gfx_render_pipeline pipeline, gfx_u32 index);
+gfx_bind_group_layout gfx_compute_pipeline_get_bind_group_layout(gfx_compute_pipeline pipeline, gfx_u32 index);
+
+/* Commands */
+gfx_result gfx_create_command_encoder(gfx_device device, const char* label, gfx_command_encoder* out);
+gfx_render_pass gfx_encoder_begin_render_pass(gfx_command_encoder encoder, const gfx_render_pass_desc* desc);
+gfx_compute_pass gfx_encoder_begin_compute_pass(gfx_command_encoder encoder, const char* label);
+void gfx_encoder_copy_buffer_to_buffer(gfx_command_encoder encoder, gfx_buffer src, gfx_u64 src_offset, gfx_buffer dst, gfx_u64 dst_offset, gfx_u64 size);
+void gfx_encoder_copy_buffer_to_texture(gfx_command_encoder encoder, const gfx_image_copy_buffer* src, const gfx_image_copy_texture* dst, const gfx_extent3d* size);
+void gfx_encoder_copy_texture_to_buffer(gfx_command_encoder encoder, const gfx_image_copy_texture* src, const gfx_image_copy_buffer* dst, const gfx_extent3d* size);
+void gfx_encoder_copy_texture_to_texture(gfx_command_encoder encoder, const gfx_image_copy_texture* src, const gfx_image_copy_texture* dst, const gfx_extent3d* size);
+void gfx_encoder_clear_buffer(gfx_command_encoder encoder, gfx_buffer buffer, gfx_u64 offset, gfx_u64 size);
+void gfx_encoder_resolve_query_set(gfx_command_encoder encoder, gfx_query_set set, gfx_u32 first, gfx_u32 count, gfx_buffer dst, gfx_u64 offset);
+void gfx_encoder_push_debug_group(gfx_command_encoder encoder, const char* label);
+void gfx_encoder_pop_debug_group(gfx_command_encoder encoder);
+void gfx_encoder_insert_debug_marker(gfx_command_encoder encoder, const char* label);
+gfx_command_buffer gfx_encoder_finish(gfx_command_encoder encoder, const char* label);
+
+void gfx_render_pass_set_pipeline(gfx_render_pass pass, gfx_render_pipeline pipeline);
+void gfx_render_pass_set_bind_group(gfx_render_pass pass, gfx_u32 index, gfx_bind_group group, gfx_u32 dynamic_offset_count, const gfx_u32* dynamic_offsets);
+void gfx_render_pass_set_vertex_buffer(gfx_render_pass pass, gfx_u32 slot, gfx_buffer buffer, gfx_u64 offset, gfx_u64 size);
+void gfx_render_pass_set_index_buffer(gfx_render_pass pass, gfx_buffer buffer, gfx_u32 format, gfx_u64 offset, gfx_u64 size);
+void gfx_render_pass_set_viewport(gfx_render_pass pass, const gfx_viewport* viewport);
+void gfx_render_pass_set_scissor_rect(gfx_render_pass pass, const gfx_rect* rect);
+void gfx_render_pass_set_blend_constant(gfx_render_pass pass, const gfx_color* color);
+void gfx_render_pass_set_stencil_reference(gfx_render_pass pass, gfx_u32 reference);
+void gfx_render_pass_set_push_constants(gfx_render_pass pass, gfx_flags stages, gfx_u32 offset, gfx_u32 size, const void* data);
+void gfx_render_pass_draw(gfx_render_pass pass, gfx_u32 vertex_count, gfx_u32 instance_count, gfx_u32 first_vertex, gfx_u32 first_instance);
+void gfx_render_pass_draw_indexed(gfx_render_pass pass, gfx_u32 index_count, gfx_u32 instance_count, gfx_u32 first_index, gfx_i32 base_vertex, gfx_u32 first_instance);
+void gfx_render_pass_draw_indirect(gfx_render_pass pass, gfx_buffer buffer, gfx_u64 offset);
+void gfx_render_pass_draw_indexed_indirect(gfx_render_pass pass, gfx_buffer buffer, gfx_u64 offset);
+void gfx_render_pass_begin_occlusion_query(gfx_render_pass pass, gfx_u32 index);
+void gfx_render_pass_end_occlusion_query(gfx_render_pass pass);
+void gfx_render_pass_end(gfx_render_pass pass);
+
+void gfx_compute_pass_set_pipeline(gfx_compute_pass pass, gfx_compute_pipeline pipeline);
+void gfx_compute_pass_set_bind_group(gfx_compute_pass pass, gfx_u32 index, gfx_bind_group group, gfx_u32 dynamic_offset_count, const gfx_u32* dynamic_offsets);
+void gfx_compute_pass_set_push_constants(gfx_compute_pass pass, gfx_u32 offset, gfx_u32 size, const void* data);
+void gfx_compute_pass_dispatch(gfx_compute_pass pass, gfx_u32 x, gfx_u32 y, gfx_u32 z);
+void gfx_compute_pass_dispatch_indirect(gfx_compute_pass pass, gfx_buffer buffer, gfx_u64 offset);
+void gfx_compute_pass_end(gfx_compute_pass pass);
+
+/* Submission and presentation */
+void gfx_queue_submit(gfx_queue queue, gfx_u32 count, const gfx_command_buffer* buffers);
+void gfx_queue_write_buffer(gfx_queue queue, gfx_buffer buffer, gfx_u64 offset, const void* data, gfx_size size);
+void gfx_queue_write_texture(gfx_queue queue, const gfx_image_copy_texture* dst, const void* data, gfx_size size, const gfx_image_copy_buffer* layout, const gfx_extent3d* extent);
+void gfx_queue_on_submitted_work_done(gfx_queue queue, gfx_work_done_callback callback, void* user_data);
+gfx_result gfx_create_fence(gfx_device device, gfx_fence* out);
+gfx_result gfx_fence_wait(gfx_fence fence, gfx_u64 timeout_ns);
+void gfx_destroy_fence(gfx_fence fence);
+gfx_result gfx_create_swapchain(gfx_device device, gfx_surface surface, const gfx_swapchain_desc* desc, gfx_swapchain* out);
+void gfx_destroy_swapchain(gfx_swapchain swapchain);
+gfx_result gfx_swapchain_resize(gfx_swapchain swapchain, gfx_u32 width, gfx_u32 height);
+gfx_texture_view gfx_swapchain_acquire(gfx_swapchain swapchain, gfx_result* result);
+gfx_result gfx_swapchain_present(gfx_swapchain swapchain);
+
+/* Utilities */
+const char* gfx_result_to_string(gfx_result result);
+const char* gfx_format_to_string(gfx_texture_format format);
+gfx_u32 gfx_format_block_size(gfx_texture_format format);
+gfx_bool gfx_format_is_depth(gfx_texture_format format);
+gfx_bool gfx_format_is_compressed(gfx_texture_format format);
+gfx_u32 gfx_mip_level_count(gfx_u32 width, gfx_u32 height);
+void gfx_set_log_callback(gfx_log_callback callback, void* user_data);
+void gfx_log(gfx_log_level level, const char* format, ...);
+
+extern const gfx_color GFX_COLOR_BLACK;
+extern const gfx_color GFX_COLOR_WHITE;
+extern const gfx_color GFX_COLOR_TRANSPARENT;
+extern gfx_u32 gfx_debug_flags;
+
+#endif /* GFX_H */
@@ -0,0 +1,239 @@
+/* An Objective-C framework-style header: a root class, protocols,
+   categories and properties.  Self-contained, since Foundation isn't
+   available everywhere; callbacks are function pointers, as blocks
+   need -fblocks outside of Darwin. */
+
+typedef signed char BOOL;
+typedef long NSInteger;
+typedef unsigned long NSUInteger;
+typedef double NSTimeInterval;
+typedef struct objc_selector* SEL;
+
+#define YES ((BOOL)1)
+#define NO ((BOOL)0)
+#define NSNotFound ((NSInteger)0x7fffffffffffffffL)
+
+typedef struct _NSRange {
+    NSUInteger location;
+    NSUInteger length;
+} NSRange;
+
+typedef struct CGPoint {
+    double x;
+    double y;
+} CGPoint;
+
+typedef struct CGSize {
+    double width;
+    double height;
+} CGSize;
+
+typedef struct CGRect {
+    CGPoint origin;
+    CGSize size;
+} CGRect;
+
+typedef enum NSComparisonResult {
+    NSOrderedAscending = -1,
+    NSOrderedSame,
+    NSOrderedDescending
+} NSComparisonResult;
+
+@class Protocol, NSString, NSArray, NSDictionary, NSData, NSError, NSURL, NSDate;
+
+@protocol NSObject
+- (BOOL)isEqual:(id)object;
+- (NSUInteger)hash;
+- (Class)class;
+- (Class)superclass;
+- (id)self;
+- (BOOL)isKindOfClass:(Class)aClass;
+- (BOOL)isMemberOfClass:(Class)aClass;
+- (BOOL)respondsToSelector:(SEL)aSelector;
+- (BOOL)conformsToProtocol:(Protocol*)aProtocol;
+- (NSString*)description;
+@end
+
+@protocol NSCopying
+- (id)copyWithZone:(void*)zone;
+@end
+
+@protocol NSCoding
+- (void)encodeWithCoder:(id)coder;
+- (id)initWithCoder:(id)decoder;
+@end
+
+@interface NSObject <NSObject>
+{
+    Class isa;
+}
++ (id)alloc;
++ (id)new;
++ (Class)class;
++ (void)initialize;
+- (id)init;
+- (void)dealloc;
+- (id)copy;
+- (id)mutableCopy;
+- (id)performSelector:(SEL)aSelector;
+- (id)performSelector:(SEL)aSelector withObject:(id)object;
+@end
+
+@interface NSString : NSObject <NSCopying, NSCoding>
+@property (readonly) NSUInteger length;
++ (id)stringWithUTF8String:(const char*)bytes;
++ (id)stringWithFormat:(NSString*)format, ...;
+- (unsigned short)characterAtIndex:(NSUInteger)index;
+- (const char*)UTF8String;
+- (NSComparisonResult)compare:(NSString*)other;
+- (NSRange)rangeOfString:(NSString*)other;
+- (NSString*)substringWithRange:(NSRange)range;
+- (NSArray*)componentsSeparatedByString:(NSString*)separator;
+- (BOOL)hasPrefix:(NSString*)prefix;
+- (BOOL)hasSuffix:(NSString*)suffix;
+- (NSInteger)integerValue;
+- (double)doubleValue;
+@end
+
+@interface NSArray : NSObject <NSCopying, NSCoding>
+@property (readonly) NSUInteger count;
++ (id)array;
++ (id)arrayWithObjects:(id)first, ...;
+- (id)objectAtIndex:(NSUInteger)index;
+- (NSUInteger)indexOfObject:(id)object;
+- (BOOL)containsObject:(id)object;
+- (NSArray*)arrayByAddingObject:(id)object;
+- (void)enumerateObjectsUsingFunction:(void (*)(id obj, NSUInteger idx, BOOL* stop))fn;
+- (NSArray*)sortedArrayUsingFunction:(NSComparisonResult (*)(id a, id b, void* context))cmp context:(void*)context;
+@end
+
+@interface NSDictionary : NSObject <NSCopying, NSCoding>
+@property (readonly) NSUInteger count;
+- (id)objectForKey:(id)key;
+- (NSArray*)allKeys;
+- (NSArray*)allValues;
+- (void)enumerateKeysAndObjectsUsingFunction:(void (*)(id key, id obj, BOOL* stop))fn;
+@end
+
+@interface NSData : NSObject <NSCopying, NSCoding>
+@property (readonly) NSUInteger length;
+@property (readonly) const void* bytes;
++ (id)dataWithBytes:(const void*)bytes length:(NSUInteger)length;
++ (id)dataWithContentsOfURL:(NSURL*)url;
+@end
+
+@interface NSError : NSObject <NSCopying, NSCoding>
+@property (readonly, copy) NSString* domain;
+@property (readonly) NSInteger code;
+@property (readonly, copy) NSDictionary* userInfo;
++ (id)errorWithDomain:(NSString*)domain code:(NSInteger)code userInfo:(NSDictionary*)info;
+@end
+
+@interface NSURL : NSObject <NSCopying, NSCoding>
+@property (readonly, copy) NSString* absoluteString;
+@property (readonly, copy) NSString* scheme;
+@property (readonly, copy) NSString* host;
+@property (readonly, copy) NSString* path;
++ (id)URLWithString:(NSString*)string;
++ (id)fileURLWithPath:(NSString*)path;
+@end
+
+@interface NSDate : NSObject <NSCopying, NSCoding>
+@property (readonly) NSTimeInterval timeIntervalSince1970;
++ (id)date;
++ (id)dateWithTimeIntervalSinceNow:(NSTimeInterval)seconds;
+- (NSComparisonResult)compare:(NSDate*)other;
+@end
+
+@interface NSString (PathUtilities)
+@property (readonly, copy) NSString* lastPathComponent;
+@property (readonly, copy) NSString* pathExtension;
+- (NSString*)stringByAppendingPathComponent:(NSString*)component;
+- (NSString*)stringByDeletingLastPathComponent;
+@end
+
+@interface NSArray (Functional)
+- (NSArray*)map:(id (*)(id obj))fn;
+- (NSArray*)filter:(BOOL (*)(id obj))fn;
+- (id)reduce:(id)initial with:(id (*)(id acc, id obj))fn;
+@end
+
+@protocol XYDocumentDelegate;
+@protocol XYViewDelegate;
+
+typedef void (*XYCompletionHandler)(BOOL success, NSError* error, void* context);
+typedef void (*XYProgressHandler)(double fraction, void* context);
+
+typedef enum XYDocumentState {
+    XYDocumentStateNormal = 0,
+    XYDocumentStateClosed = 1 << 0,
+    XYDocumentStateInConflict = 1 << 1,
+    XYDocumentStateSavingError = 1 << 2,
+    XYDocumentStateEditingDisabled = 1 << 3
+} XYDocumentState;
+
+@interface XYDocument : NSObject <NSCoding>
+{
+    NSURL* _fileURL;
+    NSDate* _modified;
+    XYDocumentState _state;
+}
+@property (readonly, copy) NSURL* fileURL;
+@property (copy) NSString* displayName;
+@property (readonly) XYDocumentState documentState;
+@property (readonly) BOOL hasUnsavedChanges;
+@property (assign) id<XYDocumentDelegate> delegate;
+- (id)initWithFileURL:(NSURL*)url;
+- (void)openWithCompletionHandler:(XYCompletionHandler)handler;
+- (void)closeWithCompletionHandler:(XYCompletionHandler)handler;
+- (void)saveToURL:(NSURL*)url completionHandler:(XYCompletionHandler)handler;
+- (id)contentsForType:(NSString*)type error:(NSError**)error;
+- (BOOL)loadFromContents:(id)contents ofType:(NSString*)type error:(NSError**)error;
+- (void)updateChangeCount:(NSInteger)change;
+@end
+
+@protocol XYDocumentDelegate <NSObject>
+- (void)documentDidOpen:(XYDocument*)document;
+- (void)document:(XYDocument*)document didFailWithError:(NSError*)error;
+- (void)document:(XYDocument*)document didUpdateProgress:(double)fraction;
+@end
+
+@interface XYView : NSObject
+@property CGRect frame;
+@property CGRect bounds;
+@property (readonly) XYView* superview;
+@property (readonly, copy) NSArray* subviews;
+@property BOOL hidden;
+@property double alpha;
+@property (assign) id<XYViewDelegate> delegate;
+- (id)initWithFrame:(CGRect)frame;
+- (void)addSubview:(XYView*)view;
+- (void)removeFromSuperview;
+- (void)setNeedsLayout;
+- (void)layoutSubviews;
+- (void)drawRect:(CGRect)rect;
+- (CGPoint)convertPoint:(CGPoint)point toView:(XYView*)view;
+- (XYView*)hitTest:(CGPoint)point;
++ (void)animateWithDuration:(NSTimeInterval)duration animations:(void (*)(void* context))animations completion:(void (*)(BOOL finished, void* context))completion context:(void*)context;
+@end
+
+@protocol XYViewDelegate <NSObject>
+- (BOOL)viewShouldBeginEditing:(XYView*)view;
+- (void)view:(XYView*)view didResize:(CGSize)size;
+@end
+
+@interface XYView (Accessibility)
+@property (copy) NSString* accessibilityLabel;
+@property (copy) NSString* accessibilityHint;
+@property BOOL isAccessibilityElement;
+@end
+
+@interface XYDocumentView : XYView <XYDocumentDelegate>
+@property (retain) XYDocument* document;
+@property XYProgressHandler progressHandler;
+- (void)reloadData;
+@end
+
+extern NSString* const XYDocumentDidSaveNotification;
+extern NSString* const XYErrorDomain;
+extern const double XYDefaultAnimationDuration;
@@ -0,0 +1,217 @@
+// A template-heavy C++ header: the standard containers, plus a small
+// library of its own with class templates, partial specializations
+// and explicit instantiations, which c2ffi has to lay out.
+
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <optional>
+#include <set>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+#include <utility>
+#include <variant>
+#include <vector>
+
+namespace geo {
+    template<typename T, std::size_t N>
+    struct vec {
+        T v[N];
+
+        T& operator[](std::size_t i) { return v[i]; }
+        const T& operator[](std::size_t i) const { return v[i]; }
+    };
+
+    template<typename T>
+    struct vec<T, 2> {
+        T x, y;
+    };
+
+    template<typename T>
+    struct vec<T, 3> {
+        T x, y, z;
+    };
+
+    template<typename T>
+    struct vec<T, 4> {
+        T x, y, z, w;
+    };
+
+    template<typename T, std::size_t R, std::size_t C>
+    struct mat {
+        vec<T, C> rows[R];
+    };
+
+    template<typename T>
+    struct aabb {
+        vec<T, 3> min;
+        vec<T, 3> max;
+    };
+
+    template<typename T>
+    struct ray {
+        vec<T, 3> origin;
+        vec<T, 3> direction;
+        T tmin, tmax;
+    };
+
+    typedef vec<float, 2> vec2;
+    typedef vec<float, 3> vec3;
+    typedef vec<float, 4> vec4;
+    typedef vec<double, 3> dvec3;
+    typedef vec<int, 2> ivec2;
+    typedef mat<float, 3, 3> mat3;
+    typedef mat<float, 4, 4> mat4;
+    typedef aabb<float> box;
+
+    template<typename T>
+    T dot(const vec<T, 3>& a, const vec<T, 3>& b);
+
+    template<typename T>
+    vec<T, 3> cross(const vec<T, 3>& a, const vec<T, 3>& b);
+
+    float length(const vec3& v);
+    vec3 normalize(const vec3& v);
+    mat4 perspective(float fovy, float aspect, float znear, float zfar);
+    mat4 look_at(const vec3& eye, const vec3& center, const vec3& up);
+    bool intersect(const ray<float>& r, const box& b, float* t);
+}
+
+namespace ecs {
+    typedef std::uint32_t entity;
+
+    template<typename... Components>
+    struct archetype {
+        std::vector<entity> entities;
+        std::tuple<std::vector<Components>...> columns;
+    };
+
+    template<typename T>
+    class pool {
+    public:
+        typedef T value_type;
+
+        pool();
+        ~pool();
+
+        T* get(entity e);
+        const T* get(entity e) const;
+        T& emplace(entity e, const T& value);
+        void erase(entity e);
+        std::size_t size() const { return _dense.size(); }
+
+    private:
+        std::vector<std::uint32_t> _sparse;
+        std::vector<entity> _dense;
+        std::vector<T> _values;
+    };
+
+    template<typename T>
+    class handle {
+        std::shared_ptr<pool<T>> _pool;
+        entity _e;
+
+    public:
+        explicit handle(std::shared_ptr<pool<T>> p, entity e) : _pool(p), _e(e) { }
+        T* operator->() { return _pool->get(_e); }
+    };
+
+    struct transform {
+        geo::vec3 position;
+        geo::vec4 rotation;
+        geo::vec3 scale;
+    };
+
+    struct velocity {
+        geo::vec3 linear;
+        geo::vec3 angular;
+    };
+
+    struct name {
+        std::string value;
+    };
+
+    struct mesh {
+        std::vector<geo::vec3> positions;
+        std::vector<geo::vec3> normals;
+        std::vector<geo::vec2> uvs;
+        std::vector<std::uint32_t> indices;
+        geo::box bounds;
+    };
+
+    typedef std::variant<std::monostate, bool, std::int64_t, double, std::string> property;
+
+    class world {
+    public:
+        world();
+        ~world();
+
+        entity create();
+        void destroy(entity e);
+
+        template<typename T>
+        pool<T>& components();
+
+        void set_property(entity e, const std::string& key, property value);
+        std::optional<property> get_property(entity e, const std::string& key) const;
+
+        void each(const std::function<void(entity, transform&, velocity&)>& fn);
+
+    private:
+        std::vector<entity> _free;
+        std::unordered_map<entity, std::map<std::string, property>> _properties;
+        std::set<entity> _alive;
+        std::map<std::string, std::unique_ptr<void, void (*)(void*)>> _pools;
+    };
+
+    extern template class pool<transform>;
+    extern template class pool<velocity>;
+    extern template class pool<name>;
+    extern template class pool<mesh>;
+}
+
+namespace io {
+    template<typename K, typename V, typename Hash = std::hash<K>>
+    class lru_cache {
+        std::size_t _capacity;
+        std::unordered_map<K, std::pair<V, std::size_t>, Hash> _entries;
+        std::map<std::size_t, K> _order;
+
+    public:
+        explicit lru_cache(std::size_t capacity) : _capacity(capacity) { }
+        std::optional<V> get(const K& key);
+        void put(const K& key, V value);
+    };
+
+    struct blob {
+        std::vector<std::uint8_t> data;
+        std::string mime_type;
+    };
+
+    typedef lru_cache<std::string, std::shared_ptr<blob>> blob_cache;
+    typedef std::function<void(const std::string&, std::shared_ptr<blob>)> load_callback;
+
+    class loader {
+    public:
+        explicit loader(std::size_t cache_size);
+        void load(const std::string& path, load_callback done);
+        std::array<std::size_t, 4> stats() const;
+
+    private:
+        blob_cache _cache;
+        std::vector<std::pair<std::string, load_callback>> _pending;
+    };
+}
+
+template struct geo::vec<float, 2>;
+template struct geo::vec<float, 3>;
+template struct geo::vec<float, 4>;
+template struct geo::vec<double, 3>;
+template struct geo::mat<float, 4, 4>;
+template struct geo::aabb<float>;
+template struct ecs::archetype<ecs::transform, ecs::velocity>;
+template struct ecs::archetype<ecs::transform, ecs::mesh, ecs::name>;
+template class io::lru_cache<std::string, std::shared_ptr<io::blob>>;
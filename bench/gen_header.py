@@ -0,0 +1,150 @@
+#!/usr/bin/env python3
+#
+#   c2ffi
+#   Copyright (C) 2013  Ryan Pavlik
+#
+#   This file is part of c2ffi.
+#
+#   c2ffi is free software: you can redistribute it and/or modify
+#   it under the terms of the GNU General Public License as published by
+#   the Free Software Foundation, either version 2 of the License, or
+#   (at your option) any later version.
+#
+#   c2ffi is distributed in the hope that it will be useful,
+#   but WITHOUT ANY WARRANTY; without even the implied warranty of
+#   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#   GNU General Public License for more details.
+#
+#   You should have received a copy of the GNU General Public License
+#   along with c2ffi.  If not, see <http://www.gnu.org/licenses/>.
+
+"""Generate a synthetic header for scaling benchmarks.
+
+Each kind of declaration has its own count, so one dimension can be
+swept while the rest stay fixed.  The output only depends on the
+parameters.
+"""
+
+import argparse
+import sys
+
+# name: (default, help)
+PARAMS = {
+    "structs": (100, "number of structs"),
+    "fields": (8, "fields per struct"),
+    "depth": (1, "levels of nested struct in each struct"),
+    "functions": (200, "number of functions"),
+    "enums": (20, "number of enums"),
+    "enumerators": (16, "enumerators per enum"),
+    "typedefs": (20, "number of typedef chains"),
+    "chain": (4, "typedefs in each chain"),
+    "macros": (200, "number of object-like macros"),
+    "templates": (0, "template instantiations (C++ only)"),
+}
+
+FIELD_TYPES = ["int", "unsigned int", "long", "double", "float", "char*", "unsigned char", "short"]
+
+
+def defaults():
+    return dict((name, default) for name, (default, _) in PARAMS.items())
+
+
+def gen_struct(out, name, fields, depth, indent):
+    pad = "    " * indent
+    out.append("%sstruct %s {" % (pad, name))
+
+    for f in range(fields):
+        out.append("%s    %s f%d;" % (pad, FIELD_TYPES[f % len(FIELD_TYPES)], f))
+
+    if depth > 0:
+        gen_struct(out, name + "_n", fields, depth - 1, indent + 1)
+        out[-1] += " nested;"
+
+    out.append("%s}" % pad)
+
+
+def generate(p, cxx=False):
+    out = ["/* Generated by bench/gen_header.py: %s */" %
+           " ".join("%s=%d" % (k, p[k]) for k in sorted(p))]
+    out.append("")
+
+    for i in range(p["macros"]):
+        if i % 3 == 0:
+            out.append("#define GEN_MACRO_%d %d" % (i, i))
+        elif i % 3 == 1:
+            out.append("#define GEN_MACRO_%d (GEN_MACRO_%d * 2 + %d)" % (i, i - 1, i))
+        else:
+            out.append("#define GEN_MACRO_%d \"macro %d\"" % (i, i))
+    out.append("")
+
+    for i in range(p["enums"]):
+        out.append("enum gen_enum_%d {" % i)
+        for e in range(p["enumerators"]):
+            out.append("    GEN_ENUM_%d_%d = %d," % (i, e, e))
+        out.append("};")
+    out.append("")
+
+    for i in range(p["typedefs"]):
+        prev = FIELD_TYPES[i % len(FIELD_TYPES)]
+        for c in range(p["chain"]):
+            name = "gen_type_%d_%d" % (i, c)
+            out.append("typedef %s %s;" % (prev, name))
+            prev = name
+    out.append("")
+
+    for i in range(p["structs"]):
+        gen_struct(out, "gen_struct_%d" % i, p["fields"], p["depth"], 0)
+        out[-1] += ";"
+    out.append("")
+
+    for i in range(p["functions"]):
+        params = []
+        for a in range(i % 5):
+            if p["structs"] and a == 0:
+                params.append("struct gen_struct_%d* s" % (i % p["structs"]))
+            else:
+                params.append("%s a%d" % (FIELD_TYPES[(i + a) % len(FIELD_TYPES)], a))
+        out.append("%s gen_function_%d(%s);" %
+                   (FIELD_TYPES[i % len(FIELD_TYPES)], i, ", ".join(params) or "void"))
+    out.append("")
+
+    if cxx and p["templates"]:
+        out.append("template<typename T, int N>")
+        out.append("struct gen_template {")
+        out.append("    T data[N];")
+        out.append("    T* next;")
+        out.append("    int size;")
+        out.append("};")
+        out.append("")
+
+        for i in range(p["templates"]):
+            out.append("template struct gen_template<%s, %d>;" %
+                       (FIELD_TYPES[i % len(FIELD_TYPES)], i // len(FIELD_TYPES) + 1))
+        out.append("")
+
+    return "\n".join(out) + "\n"
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__)
+
+    for name, (default, help) in sorted(PARAMS.items()):
+        parser.add_argument("--" + name, type=int, default=default,
+                            help="%s (default: %d)" % (help, default))
+
+    parser.add_argument("--cxx", action="store_true", help="generate C++ (needed for --templates)")
+    parser.add_argument("-o", "--output", help="output file (default: stdout)")
+    opts = parser.parse_args()
+
+    p = dict((name, getattr(opts, name)) for name in PARAMS)
+    text = generate(p, opts.cxx)
+
+    if opts.output:
+        with open(opts.output, "w") as f:
+            f.write(text)
+    else:
+        sys.stdout.write(text)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,180 @@
+#!/usr/bin/env python3
+#
+#   c2ffi
+#   Copyright (C) 2013  Ryan Pavlik
+#
+#   This file is part of c2ffi.
+#
+#   c2ffi is free software: you can redistribute it and/or modify
+#   it under the terms of the GNU General Public License as published by
+#   the Free Software Foundation, either version 2 of the License, or
+#   (at your option) any later version.
+#
+#   c2ffi is distributed in the hope that it will be useful,
+#   but WITHOUT ANY WARRANTY; without even the implied warranty of
+#   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#   GNU General Public License for more details.
+#
+#   You should have received a copy of the GNU General Public License
+#   along with c2ffi.  If not, see <http://www.gnu.org/licenses/>.
+
+"""Run c2ffi over the headers in bench/corpus with each driver.
+
+Every case is run --repeat times with --stats=json; the median wall
+time is used for the rates.  Results are printed as a table and saved
+as JSON with --out, and --compare prints the change against a saved
+run.
+"""
+
+import argparse
+import datetime
+import json
+import os
+import platform
+import statistics
+import subprocess
+import sys
+import time
+
+BENCH_DIR = os.path.dirname(os.path.abspath(__file__))
+CORPUS_DIR = os.path.join(BENCH_DIR, "corpus")
+
+# name, file, extra c2ffi arguments
+CORPUS = [
+    ("libc", "libc.h", ["-x", "c"]),
+    ("gfx", "gfx.h", ["-x", "c"]),
+    ("templates", "templates.hpp", ["-x", "c++", "--std", "c++17"]),
+    ("objc", "objc.h", ["-x", "objc"]),
+]
+
+DRIVERS = ["json", "sexp", "cbor", "null"]
+
+
+def run_once(c2ffi, path, args, driver):
+    """Run c2ffi once, returning its wall time and --stats record."""
+    cmd = [c2ffi, "--stats=json", "-D", driver, "-o", os.devnull] + args + [path]
+
+    start = time.perf_counter()
+    proc = subprocess.run(cmd, stdout=subprocess.DEVNULL, stderr=subprocess.PIPE,
+                          universal_newlines=True)
+    wall = time.perf_counter() - start
+
+    stats = None
+    for line in proc.stderr.splitlines():
+        if line.startswith("{"):
+            stats = json.loads(line)
+
+    if proc.returncode != 0 or stats is None:
+        sys.stderr.write("warning: %s exited with %d\n%s" % (" ".join(cmd), proc.returncode, proc.stderr))
+
+    return wall, stats
+
+
+def run_case(c2ffi, name, filename, args, driver, repeat):
+    path = os.path.join(CORPUS_DIR, filename)
+    walls, cpus, rss = [], [], 0
+    phases = {}
+    stats = None
+
+    for _ in range(repeat):
+        wall, s = run_once(c2ffi, path, args, driver)
+        walls.append(wall)
+
+        if s is None:
+            continue
+
+        stats = s
+        cpus.append(s["total"]["cpu"])
+        rss = max(rss, s["peak_rss_kib"])
+
+        for phase, t in s["phases"].items():
+            phases.setdefault(phase, []).append(t["wall"])
+
+    wall = statistics.median(walls)
+    decls = sum(stats["decls"].values()) if stats else 0
+    out_bytes = stats["output_bytes"] if stats else 0
+
+    return {
+        "name": name,
+        "driver": driver,
+        "runs": repeat,
+        "wall_s": wall,
+        "wall_min_s": min(walls),
+        "cpu_s": statistics.median(cpus) if cpus else 0,
+        "peak_rss_kib": rss,
+        "decls": decls,
+        "decls_per_s": decls / wall if wall else 0,
+        "output_bytes": out_bytes,
+        "output_mb_per_s": out_bytes / 1e6 / wall if wall else 0,
+        "ast_bytes": stats["ast_bytes"] if stats else 0,
+        "phases_s": dict((p, statistics.median(v)) for p, v in phases.items()),
+    }
+
+
+def print_table(results, baseline=None):
+    base = {}
+    if baseline:
+        for r in baseline["results"]:
+            base[(r["name"], r["driver"])] = r
+
+    header = "%-10s %-5s %9s %11s %9s %10s" % ("header", "drv", "wall ms", "decls/s", "MB/s", "RSS MiB")
+    if base:
+        header += " %8s" % "vs base"
+    print(header)
+
+    for r in results:
+        line = "%-10s %-5s %9.1f %11.0f %9.2f %10.1f" % (
+            r["name"], r["driver"], r["wall_s"] * 1000, r["decls_per_s"],
+            r["output_mb_per_s"], r["peak_rss_kib"] / 1024.0)
+
+        b = base.get((r["name"], r["driver"]))
+        if b and b["wall_s"]:
+            line += " %+7.1f%%" % ((r["wall_s"] / b["wall_s"] - 1) * 100)
+
+        print(line)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--c2ffi", default="c2ffi", help="c2ffi executable")
+    parser.add_argument("--repeat", type=int, default=5, help="runs per case (default: 5)")
+    parser.add_argument("--header", action="append", default=[],
+                        help="only run this header; may be repeated")
+    parser.add_argument("--driver", action="append", default=[],
+                        help="only run this driver; may be repeated")
+    parser.add_argument("--out", help="save results as JSON")
+    parser.add_argument("--compare", help="compare against results saved with --out")
+    opts = parser.parse_args()
+
+    baseline = None
+    if opts.compare:
+        with open(opts.compare) as f:
+            baseline = json.load(f)
+
+    results = []
+    for name, filename, args in CORPUS:
+        for driver in DRIVERS:
+            if opts.header and name not in opts.header:
+                continue
+            if opts.driver and driver not in opts.driver:
+                continue
+
+            results.append(run_case(opts.c2ffi, name, filename, args, driver, opts.repeat))
+
+    print_table(results, baseline)
+
+    if opts.out:
+        with open(opts.out, "w") as f:
+            json.dump({
+                "c2ffi": opts.c2ffi,
+                "date": datetime.datetime.now().isoformat(),
+                "host": platform.node(),
+                "platform": platform.platform(),
+                "results": results,
+            }, f, indent=2)
+            f.write("\n")
+
+
+if __name__ == "__main__":
+    main()
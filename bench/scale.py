@@ -0,0 +1,147 @@
+#!/usr/bin/env python3
+#
+#   c2ffi
+#   Copyright (C) 2013  Ryan Pavlik
+#
+#   This file is part of c2ffi.
+#
+#   c2ffi is free software: you can redistribute it and/or modify
+#   it under the terms of the GNU General Public License as published by
+#   the Free Software Foundation, either version 2 of the License, or
+#   (at your option) any later version.
+#
+#   c2ffi is distributed in the hope that it will be useful,
+#   but WITHOUT ANY WARRANTY; without even the implied warranty of
+#   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#   GNU General Public License for more details.
+#
+#   You should have received a copy of the GNU General Public License
+#   along with c2ffi.  If not, see <http://www.gnu.org/licenses/>.
+
+"""Measure how c2ffi scales with each dimension of a synthetic header.
+
+Every parameter of gen_header.py is swept in turn, doubling it from
+its base value while the others stay fixed, and c2ffi's time and peak
+RSS are recorded at each step.  The slope of log(time) against
+log(size) is the scaling exponent: about 1 for linear behavior, and
+anything well above that is flagged.  Peak RSS is reported as its
+growth from the first step to the last.
+"""
+
+import argparse
+import json
+import math
+import os
+import sys
+import tempfile
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+
+import gen_header
+import run
+
+# Sweeping these from 0 would say nothing about how they scale
+BASE = {
+    "structs": 100,
+    "fields": 8,
+    "depth": 1,
+    "functions": 200,
+    "enums": 20,
+    "enumerators": 16,
+    "typedefs": 20,
+    "chain": 4,
+    "macros": 200,
+    "templates": 50,
+}
+
+# Nesting grows one level at a time; everything else doubles
+STEPS = {"depth": [1, 2, 4, 8, 16]}
+
+
+def slope(xs, ys):
+    """Least-squares slope of log(ys) over log(xs)."""
+    pts = [(math.log(x), math.log(y)) for x, y in zip(xs, ys) if x > 0 and y > 0]
+    if len(pts) < 2:
+        return 0.0
+
+    mx = sum(p[0] for p in pts) / len(pts)
+    my = sum(p[1] for p in pts) / len(pts)
+    num = sum((p[0] - mx) * (p[1] - my) for p in pts)
+    den = sum((p[0] - mx) ** 2 for p in pts)
+    return num / den if den else 0.0
+
+
+def sweep(c2ffi, tmpdir, param, values, driver, repeat):
+    points = []
+
+    for v in values:
+        p = dict(BASE)
+        p[param] = v
+
+        cxx = param == "templates"
+        path = os.path.join(tmpdir, "%s-%d.%s" % (param, v, "hpp" if cxx else "h"))
+        with open(path, "w") as f:
+            f.write(gen_header.generate(p, cxx))
+
+        args = ["-x", "c++"] if cxx else ["-x", "c"]
+        r = run.run_case(c2ffi, param, path, args, driver, repeat)
+        r["value"] = v
+        points.append(r)
+
+    return points
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--c2ffi", default="c2ffi", help="c2ffi executable")
+    parser.add_argument("--driver", default="json", help="output driver (default: json)")
+    parser.add_argument("--repeat", type=int, default=3, help="runs per point (default: 3)")
+    parser.add_argument("--steps", type=int, default=5, help="doublings per parameter (default: 5)")
+    parser.add_argument("--param", action="append", default=[],
+                        help="only sweep this parameter; may be repeated")
+    parser.add_argument("--threshold", type=float, default=1.2,
+                        help="flag exponents above this (default: 1.2)")
+    parser.add_argument("--out", help="save results as JSON")
+    opts = parser.parse_args()
+
+    results = {}
+    flagged = []
+
+    with tempfile.TemporaryDirectory(prefix="c2ffi-scale-") as tmpdir:
+        for param in sorted(BASE):
+            if opts.param and param not in opts.param:
+                continue
+
+            values = STEPS.get(param) or [BASE[param] * 2 ** i for i in range(opts.steps)]
+            points = sweep(opts.c2ffi, tmpdir, param, values, opts.driver, opts.repeat)
+
+            # Subtract the fixed cost of starting clang, taken from the
+            # smallest point, so it doesn't hide the growth
+            init = points[0]["phases_s"].get("init", 0)
+            times = [max(pt["wall_s"] - init, 1e-9) for pt in points]
+            rss = [pt["peak_rss_kib"] for pt in points]
+
+            time_exp = slope(values, times)
+            rss_growth = float(rss[-1]) / rss[0] if rss[0] else 0.0
+            results[param] = {"points": points, "time_exponent": time_exp, "rss_growth": rss_growth}
+
+            print("%-12s %s" % (param, "  ".join("%d:%.1fms" % (v, pt["wall_s"] * 1000)
+                                                 for v, pt in zip(values, points))))
+            print("%-12s time ^%.2f, RSS x%.2f%s" % ("", time_exp, rss_growth,
+                                                     "  <-- superlinear" if time_exp > opts.threshold else ""))
+
+            if time_exp > opts.threshold:
+                flagged.append(param)
+
+    if opts.out:
+        with open(opts.out, "w") as f:
+            json.dump(results, f, indent=2)
+            f.write("\n")
+
+    if flagged:
+        print("superlinear: %s" % ", ".join(flagged))
+
+
+if __name__ == "__main__":
+    main()
@@ -20,6 +20,7 @@
 
 #include <iostream>
 #include <map>
+#include <sstream>
 
 #include <clang/AST/ASTConsumer.h>
 #include <clang/AST/ASTContext.h>
@@ -42,9 +43,14 @@
 #include <llvm/TargetParser/Host.h>
 #include <llvm/Support/raw_ostream.h>
 #include <llvm/Support/ConvertUTF.h>
+#include <llvm/Support/TimeProfiler.h>
 
 #include "c2ffi.h"
 #include "c2ffi/ast.h"
+#include "c2ffi/filter.h"
+#include "c2ffi/shard.h"
+#include "c2ffi/stats.h"
+#include "c2ffi/symbols.h"
 
 using namespace c2ffi;
 
@@ -77,6 +83,14 @@ Decl* C2FFIASTConsumer::proc(const clang::Decl* d, Decl* decl)
 
     if(decl->location() == "") decl->set_location(_ci, d);
 
+    if(_config.stats) _config.stats->count_decl(d->getDeclKindName());
+
+    StatsTimer           timer(_config.stats, Stats::WRITE);
+    llvm::TimeTraceScope trace("write", [&] { return decl->name(); });
+
+    // The types decl refers to, if they're new
+    if(_types) _types->write_pending(*_od, _mid);
+
     if(_mid)
         _od->write_between();
     else
@@ -86,7 +100,15 @@ Decl* C2FFIASTConsumer::proc(const clang::Decl* d, Decl* decl)
     return decl;
 }
 
-#define PROC decl = proc(d, make_decl(x))
+// make_decl(), as its own --time-trace event
+template<typename T>
+static Decl* traced_make_decl(C2FFIASTConsumer* ast, const T* x)
+{
+    llvm::TimeTraceScope trace("make_decl", [&] { return std::string(x->getDeclKindName()) + " " + x->getNameAsString(); });
+    return ast->make_decl(x);
+}
+
+#define PROC decl = proc(d, traced_make_decl(this, x))
 
 void C2FFIASTConsumer::HandleDecl(clang::Decl* d, const clang::NamedDecl* ns)
 {
@@ -94,6 +116,17 @@ void C2FFIASTConsumer::HandleDecl(clang::Decl* d, const clang::NamedDecl* ns)
     const clang::NamedDecl* old_ns = _ns;
     _ns                            = ns;
 
+    // Before anything is converted, so filtered decls cost nothing
+    if(_filter && !_filter->wanted(d->getLocation())) {
+        _ns = old_ns;
+        return;
+    }
+
+    if(_symbols && !_symbols->wanted(d)) {
+        _ns = old_ns;
+        return;
+    }
+
     if(d->isInvalidDecl()) {
         std::cerr << "Skipping invalid Decl:" << std::endl;
         d->dump();
@@ -143,8 +176,13 @@ void C2FFIASTConsumer::HandleDecl(clang::Decl* d, const clang::NamedDecl* ns)
     else if_cast(x, clang::NamedDecl, d) PROC;
     else decl = make_decl(d);
 
-    if(decl) delete decl;
     _ns = old_ns;
+
+    // Everything converted for a decl goes once it's written, nested
+    // ones included: a parent is written before its children.  Table
+    // entries may point into the arena, so they're written first.
+    if(_types) _types->write_pending(*_od, _mid);
+    _arena.reset();
 }
 
 void C2FFIASTConsumer::HandleNS(const clang::NamespaceDecl* ns)
@@ -162,12 +200,116 @@ void C2FFIASTConsumer::HandleDeclContext(const clang::DeclContext* dc, const cla
 bool C2FFIASTConsumer::HandleTopLevelDecl(clang::DeclGroupRef d)
 {
     clang::DeclGroupRef::iterator it;
-
-    for(it = d.begin(); it != d.end(); ++it) HandleDecl(*it);
+    StatsTimer                    timer(_config.stats, Stats::CONVERT);
+    llvm::TimeTraceScope          trace("HandleTopLevelDecl");
+
+    HandlePCHDecls();
+
+    for(it = d.begin(); it != d.end(); ++it) {
+        if(_symbols)
+            _symbols->add(*it);
+        else if(_shards)
+            HandleShardDecl(*it);
+        else
+            HandleDecl(*it);
+    }
 
     return true;
 }
 
+// Output a top-level decl from --shard-dir if possible, otherwise
+// convert it, recording the output separately so it can be cached
+void C2FFIASTConsumer::HandleShardDecl(clang::Decl* d)
+{
+    std::string text;
+
+    switch(_shards->begin(d, text, _decl_id)) {
+        case ShardCache::UNSHARDED:
+            HandleDecl(d);
+            return;
+
+        case ShardCache::REPLAYED:
+            break;
+
+        case ShardCache::RECORDING: {
+            std::ostringstream buf;
+            std::ostream*      os  = &_od->os();
+            bool               mid = _mid;
+
+            _od->set_os(&buf);
+            _mid = false;
+
+            HandleDecl(d);
+
+            _od->set_os(os);
+            _mid = mid;
+
+            text = buf.str();
+            _shards->end(text);
+            break;
+        }
+    }
+
+    if(text.empty()) return;
+
+    StatsTimer           timer(_config.stats, Stats::WRITE);
+    llvm::TimeTraceScope trace("write");
+
+    if(_mid)
+        _od->write_between();
+    else
+        _mid = true;
+
+    _od->os() << text;
+}
+
+// A macro value from --macro-values; these were matched against
+// --symbols by macro name already
+void C2FFIASTConsumer::HandleMacroDecl(clang::Decl* d)
+{
+    if(_symbols)
+        _symbols->add(d, true);
+    else
+        HandleDecl(d);
+}
+
+void C2FFIASTConsumer::HandleInterestingDecl(clang::DeclGroupRef d)
+{
+    // Decls from a PCH are all handled by HandlePCHDecls()
+}
+
+void C2FFIASTConsumer::HandleTranslationUnit(clang::ASTContext& ctx)
+{
+    StatsTimer timer(_config.stats, Stats::CONVERT);
+    HandlePCHDecls();
+
+    if(!_symbols) return;
+
+    _symbols->close();
+
+    for(clang::Decl* d : _symbols->decls()) HandleDecl(d);
+}
+
+// Output the top-level decls loaded from --include-pch as if they had
+// been parsed, ahead of the first decl from the main file.
+void C2FFIASTConsumer::HandlePCHDecls()
+{
+    if(_pch_done) return;
+    _pch_done = true;
+
+    if(!_ci.getASTContext().getExternalSource()) return;
+
+    clang::TranslationUnitDecl* tu = _ci.getASTContext().getTranslationUnitDecl();
+
+    for(clang::DeclContext::decl_iterator it = tu->decls_begin(); it != tu->decls_end(); ++it)
+        if(it->isFromASTFile() && !it->isImplicit()) {
+            if(_symbols)
+                _symbols->add(*it);
+            else
+                HandleDecl(*it);
+        }
+}
+
 void C2FFIASTConsumer::PostProcess()
 {
     if(!_config.template_output) return;
@@ -191,26 +333,51 @@ void C2FFIASTConsumer::PostProcess()
 
 bool C2FFIASTConsumer::is_cur_decl(const clang::Decl* d) const
 {
-    return _cur_decls.count(d);
+    return _cur_decls.count(d) || (_shards && _shards->find_cur(d));
+}
+
+void C2FFIASTConsumer::add_cur_decl(const clang::Decl* d)
+{
+    if(_cur_decls.insert(d).second && _shards) _shards->note_cur(d);
+}
+
+unsigned int C2FFIASTConsumer::add_decl(const clang::Decl* d)
+{
+    if(!d) return 0;
+
+    ClangDeclIDMap::iterator it = _decl_map.find(d);
+    if(it != _decl_map.end()) return it->second;
+
+    unsigned int id;
+
+    if(_shards && _shards->find_id(d, id)) {
+        _decl_map[d] = id;
+        return id;
+    }
+
+    _decl_map[d] = id = ++_decl_id;
+    if(_shards) _shards->note_id(d, id);
+
+    return id;
 }
 
 Decl* C2FFIASTConsumer::make_decl(const clang::Decl* d, bool is_toplevel)
 {
-    return new UnhandledDecl("", d->getDeclKindName());
+    return _arena.make<UnhandledDecl>("", d->getDeclKindName());
 }
 
 Decl* C2FFIASTConsumer::make_decl(const clang::NamedDecl* d, bool is_toplevel)
 {
-    return new UnhandledDecl(d->getDeclName().getAsString(), d->getDeclKindName());
+    return _arena.make<UnhandledDecl>(d->getDeclName().getAsString(), d->getDeclKindName());
 }
 
 Decl* C2FFIASTConsumer::make_decl(const clang::FunctionDecl* d, bool is_toplevel)
 {
-    _cur_decls.insert(d);
+    add_cur_decl(d);
 
     clang::FunctionTemplateSpecializationInfo* spec        = d->getTemplateSpecializationInfo();
     const clang::Type*                         return_type = d->getReturnType().getTypePtr();
-    FunctionDecl*                              fd          = new FunctionDecl(
+    FunctionDecl*                              fd          = _arena.make<FunctionDecl>(
         this, d->getDeclName().getAsString(), Type::make_type(this, return_type), d->isVariadic(),
         d->isInlineSpecified(), d->getStorageClass(), (spec ? spec->TemplateArguments : NULL));
 
@@ -273,7 +440,7 @@ Decl* C2FFIASTConsumer::make_decl(const clang::VarDecl* d, bool is_toplevel)
     }
 
     Type*    t  = Type::make_type(this, d->getTypeSourceInfo()->getType().getTypePtr());
-    VarDecl* cv = new VarDecl(name, t, value, d->hasExternalStorage(), is_string);
+    VarDecl* cv = _arena.make<VarDecl>(name, t, value, d->hasExternalStorage(), is_string);
 
     if(loc != "") cv->set_location(loc);
 
@@ -286,8 +453,8 @@ Decl* C2FFIASTConsumer::make_decl(const clang::RecordDecl* d, bool is_toplevel)
 
     if(is_toplevel && name == "") return NULL;
 
-    _cur_decls.insert(d);
-    RecordDecl* rd = new RecordDecl(name, d->isUnion());
+    add_cur_decl(d);
+    RecordDecl* rd = _arena.make<RecordDecl>(name, d->isUnion());
     rd->fill_record_decl(this, d);
 
     return rd;
@@ -313,7 +480,7 @@ Decl* C2FFIASTConsumer::make_decl(const clang::TypedefDecl* d, bool is_toplevel)
     const clang::Type* t = d->getUnderlyingType().getTypePtr();
 
     if(is_underlying_valid(t)) {
-        return new TypedefDecl(d->getDeclName().getAsString(), Type::make_type(this, t));
+        return _arena.make<TypedefDecl>(d->getDeclName().getAsString(), Type::make_type(this, t));
     } else {
         std::cerr << "Skipping typedef to invalid type:" << std::endl;
         d->dump();
@@ -325,8 +492,8 @@ Decl* C2FFIASTConsumer::make_decl(const clang::EnumDecl* d, bool is_toplevel)
 {
     std::string name = d->getDeclName().getAsString();
 
-    _cur_decls.insert(d);
-    EnumDecl* decl = new EnumDecl(name);
+    add_cur_decl(d);
+    EnumDecl* decl = _arena.make<EnumDecl>(name);
 
     if(name == "") {
         decl->set_id(add_decl(d));
@@ -356,8 +523,8 @@ Decl* C2FFIASTConsumer::make_decl(const clang::CXXRecordDecl* d, bool is_topleve
 
     bool dependent = d->isDependentType();
 
-    _cur_decls.insert(d);
-    CXXRecordDecl* rd = new CXXRecordDecl(this, name, d->isUnion(), d->isClass(), template_args);
+    add_cur_decl(d);
+    CXXRecordDecl* rd = _arena.make<CXXRecordDecl>(this, name, d->isUnion(), d->isClass(), template_args);
     rd->set_id(add_cxx_decl(d));
     rd->add_functions(this, d);
 
@@ -387,7 +554,7 @@ Decl* C2FFIASTConsumer::make_decl(const clang::CXXRecordDecl* d, bool is_topleve
 
 Decl* C2FFIASTConsumer::make_decl(const clang::NamespaceDecl* d, bool is_toplevel)
 {
-    CXXNamespaceDecl* ns = new CXXNamespaceDecl(d->getNameAsString());
+    CXXNamespaceDecl* ns = _arena.make<CXXNamespaceDecl>(d->getNameAsString());
     ns->set_id(add_cxx_decl(d));
     ns->set_ns(add_cxx_decl(_ns));
 
@@ -398,8 +565,8 @@ Decl* C2FFIASTConsumer::make_decl(const clang::ObjCInterfaceDecl* d, bool is_top
 {
     const clang::ObjCInterfaceDecl* super = d->getSuperClass();
 
-    _cur_decls.insert(d);
-    ObjCInterfaceDecl* r = new ObjCInterfaceDecl(
+    add_cur_decl(d);
+    ObjCInterfaceDecl* r = _arena.make<ObjCInterfaceDecl>(
         d->getDeclName().getAsString(), super ? super->getDeclName().getAsString() : "",
         !d->hasDefinition());
 
@@ -416,17 +583,17 @@ Decl* C2FFIASTConsumer::make_decl(const clang::ObjCInterfaceDecl* d, bool is_top
 
 Decl* C2FFIASTConsumer::make_decl(const clang::ObjCCategoryDecl* d, bool is_toplevel)
 {
-    ObjCCategoryDecl* r = new ObjCCategoryDecl(
+    ObjCCategoryDecl* r = _arena.make<ObjCCategoryDecl>(
         d->getClassInterface()->getDeclName().getAsString(), d->getDeclName().getAsString());
-    _cur_decls.insert(d);
+    add_cur_decl(d);
     r->add_functions(this, d);
     return r;
 }
 
 Decl* C2FFIASTConsumer::make_decl(const clang::ObjCProtocolDecl* d, bool is_toplevel)
 {
-    ObjCProtocolDecl* r = new ObjCProtocolDecl(d->getDeclName().getAsString());
-    _cur_decls.insert(d);
+    ObjCProtocolDecl* r = _arena.make<ObjCProtocolDecl>(d->getDeclName().getAsString());
+    add_cur_decl(d);
     r->add_functions(this, d);
     return r;
 }
@@ -435,8 +602,12 @@ unsigned int C2FFIASTConsumer::decl_id(const clang::Decl* d) const
 {
     ClangDeclIDMap::const_iterator it = _decl_map.find(d);
 
+    unsigned int id = 0;
+
     if(it != _decl_map.end())
         return it->second;
+    else if(_shards && _shards->find_id(d, id))
+        return id;
     else
         return 0;
 }
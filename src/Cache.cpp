@@ -0,0 +1,324 @@
+/*
+    c2ffi
+    Copyright (C) 2013  Ryan Pavlik
+
+    This file is part of c2ffi.
+
+    c2ffi is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    c2ffi is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with c2ffi.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+   Cache layout, under --cache-dir:
+
+       xx/KEY.manifest   "c2ffi-manifest 1", the result key, then one
+                         "HASH PATH" line per file the run read
+       xx/KEY.result     "c2ffi-result 1", the byte counts of the main,
+                         macro and template outputs, then their text
+
+   The manifest key covers the main file's content and everything on
+   the command line which can change the output; the result key adds
+   the hashes listed in the manifest.  Files are written under a
+   temporary name and renamed, so concurrent runs never see a partial
+   entry.
+ */
+
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#include <llvm/ADT/SmallString.h>
+#include <llvm/Support/ErrorOr.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/MD5.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/Path.h>
+#include <llvm/Support/raw_ostream.h>
+#include <llvm/TargetParser/Host.h>
+
+#include <clang/Basic/Version.h>
+
+#include "c2ffi.h"
+#include "c2ffi/cache.h"
+#include "c2ffi/opt.h"
+
+using namespace c2ffi;
+
+// Bump whenever the output for the same input changes
+static const char* CACHE_VERSION = "c2ffi-cache 1";
+
+static std::string hex_digest(llvm::MD5& md5)
+{
+    llvm::MD5::MD5Result result;
+    md5.final(result);
+    return result.digest().str().str();
+}
+
+static bool hash_file(const std::string& path, std::string& hash)
+{
+    llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer> > buf = llvm::MemoryBuffer::getFile(path);
+    if(!buf) return false;
+
+    llvm::MD5 md5;
+    md5.update((*buf)->getBuffer());
+    hash = hex_digest(md5);
+    return true;
+}
+
+static void add_field(llvm::MD5& md5, const std::string& s)
+{
+    md5.update(s);
+    md5.update(llvm::StringRef("", 1));
+}
+
+static void add_field(llvm::MD5& md5, long n)
+{
+    add_field(md5, std::to_string(n));
+}
+
+// The binary itself stands in for a version number, so rebuilding
+// c2ffi invalidates everything it cached.
+static std::string executable_id(const config& c)
+{
+    static int                 anchor;
+    std::string                exe = llvm::sys::fs::getMainExecutable(c.c2ffi_binpath.c_str(), &anchor);
+    llvm::sys::fs::file_status st;
+
+    if(exe.empty() || llvm::sys::fs::status(exe, st)) return c.c2ffi_binpath;
+
+    std::ostringstream ss;
+    ss << exe << " " << st.getSize() << " "
+       << st.getLastModificationTime().time_since_epoch().count();
+    return ss.str();
+}
+
+bool c2ffi::write_file_atomic(const std::string& path, const std::string& data)
+{
+    llvm::SmallString<128> tmp;
+    int                    fd;
+
+    llvm::sys::fs::create_directories(llvm::sys::path::parent_path(path));
+
+    if(llvm::sys::fs::createUniqueFile(path + ".tmp-%%%%%%%%", fd, tmp)) return false;
+
+    llvm::raw_fd_ostream os(fd, true);
+    os << data;
+    os.close();
+
+    if(os.has_error()) {
+        os.clear_error();
+        llvm::sys::fs::remove(tmp);
+        return false;
+    }
+
+    if(llvm::sys::fs::rename(tmp, path)) {
+        llvm::sys::fs::remove(tmp);
+        return false;
+    }
+
+    return true;
+}
+
+static bool read_file(const std::string& path, std::string& data)
+{
+    llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer> > buf = llvm::MemoryBuffer::getFile(path);
+    if(!buf) return false;
+
+    data = (*buf)->getBuffer().str();
+    return true;
+}
+
+std::string c2ffi::config_key(const config& c)
+{
+    llvm::MD5              md5;
+    llvm::SmallString<128> cwd;
+    std::string            pch_hash;
+
+    llvm::sys::fs::current_path(cwd);
+
+    add_field(md5, CACHE_VERSION);
+    add_field(md5, clang::getClangFullVersion());
+    add_field(md5, executable_id(c));
+    add_field(md5, cwd.str().str());
+    add_field(md5, c.arch.empty() ? llvm::sys::getDefaultTargetTriple() : c.arch);
+    add_field(md5, c.lang);
+    add_field(md5, (long)c.std);
+    add_field(md5, c.drivers[0].driver->name);
+    add_field(md5, c.to_namespace);
+    add_field(md5, c.include_pch);
+
+    for(IncludeVector::const_iterator i = c.includes.begin(); i != c.includes.end(); ++i) add_field(md5, "-I" + *i);
+    for(IncludeVector::const_iterator i = c.sys_includes.begin(); i != c.sys_includes.end(); ++i)
+        add_field(md5, "-i" + *i);
+
+    add_field(md5, (long)c.nostdinc);
+    add_field(md5, (long)c.declspec);
+    add_field(md5, (long)c.wchar_size);
+    add_field(md5, (long)c.with_macro_defs);
+    add_field(md5, (long)c.macro_values);
+    add_field(md5, (long)c.skip_function_bodies);
+
+    // Only error-free runs are stored, and these decide what's an error
+    add_field(md5, (long)c.warn_as_error);
+    add_field(md5, (long)c.fail_on_error);
+    add_field(md5, (long)c.type_table);
+    add_field(md5, (long)(c.macro_output != NULL));
+    add_field(md5, (long)(c.template_output != NULL));
+
+    for(IncludeVector::const_iterator i = c.only_from.begin(); i != c.only_from.end(); ++i)
+        add_field(md5, "--only-from=" + *i);
+    for(IncludeVector::const_iterator i = c.exclude_from.begin(); i != c.exclude_from.end(); ++i)
+        add_field(md5, "--exclude-from=" + *i);
+    add_field(md5, (long)c.main_only);
+    for(IncludeVector::const_iterator i = c.symbols.begin(); i != c.symbols.end(); ++i)
+        add_field(md5, "--symbols=" + *i);
+
+    if(!c.include_pch.empty() && hash_file(c.include_pch, pch_hash)) add_field(md5, pch_hash);
+
+    return hex_digest(md5);
+}
+
+CacheEntry::CacheEntry(config& c) : _config(c), _capturing(false)
+{
+    _streams[0] = c.output;
+    _streams[1] = c.macro_output;
+    _streams[2] = c.template_output;
+
+    llvm::MD5   md5;
+    std::string main_hash;
+
+    add_field(md5, config_key(c));
+    add_field(md5, c.filename);
+    if(c.read_stdin)
+        add_field(md5, c.input_data);
+    else if(hash_file(c.filename, main_hash))
+        add_field(md5, main_hash);
+
+    _manifest_key = hex_digest(md5);
+}
+
+CacheEntry::~CacheEntry()
+{
+    release();
+}
+
+bool CacheEntry::usable(const config& c)
+{
+    return !c.cache_dir.empty() && !c.preprocess_only && c.emit_pch.empty() && c.drivers.size() == 1
+           && c.drivers[0].path.empty();
+}
+
+std::string CacheEntry::path(const std::string& key, const char* ext) const
+{
+    return _config.cache_dir + "/" + key.substr(0, 2) + "/" + key + ext;
+}
+
+bool CacheEntry::replay()
+{
+    std::ifstream manifest(path(_manifest_key, ".manifest"));
+    std::string   line, result_key;
+
+    if(!std::getline(manifest, line) || line != "c2ffi-manifest 1") return false;
+    if(!std::getline(manifest, result_key) || result_key.size() != 32) return false;
+
+    while(std::getline(manifest, line)) {
+        std::string::size_type sp = line.find(' ');
+        std::string            hash;
+
+        if(sp == std::string::npos) return false;
+        if(!hash_file(line.substr(sp + 1), hash) || hash != line.substr(0, sp)) return false;
+
+        _deps.push_back(line.substr(sp + 1));
+    }
+
+    std::string data;
+    if(!read_file(path(result_key, ".result"), data)) return false;
+
+    std::istringstream in(data);
+    size_t             sizes[NSTREAMS];
+
+    if(!std::getline(in, line) || line != "c2ffi-result 1") return false;
+
+    for(int i = 0; i < NSTREAMS; i++)
+        if(!(in >> sizes[i])) return false;
+
+    if(in.get() != '\n') return false;
+
+    size_t pos = in.tellg();
+    if(pos + sizes[0] + sizes[1] + sizes[2] != data.size()) return false;
+
+    for(int i = 0; i < NSTREAMS; i++) {
+        if(_streams[i]) _streams[i]->write(data.data() + pos, sizes[i]);
+        pos += sizes[i];
+    }
+
+    return true;
+}
+
+void CacheEntry::capture()
+{
+    for(int i = 0; i < NSTREAMS; i++)
+        if(_streams[i]) _saved[i] = _streams[i]->rdbuf(&_bufs[i]);
+
+    _capturing = true;
+}
+
+void CacheEntry::release()
+{
+    if(!_capturing) return;
+    _capturing = false;
+
+    for(int i = 0; i < NSTREAMS; i++) {
+        if(!_streams[i]) continue;
+
+        std::string text = _bufs[i].str();
+        _streams[i]->rdbuf(_saved[i]);
+        _streams[i]->write(text.data(), text.size());
+    }
+}
+
+void CacheEntry::store(const IncludeVector& deps)
+{
+    release();
+
+    const IncludeVector& files = deps;
+    std::ostringstream   manifest;
+    llvm::MD5          md5;
+
+    add_field(md5, _manifest_key);
+
+    for(IncludeVector::const_iterator i = files.begin(); i != files.end(); ++i) {
+        std::string hash;
+
+        // Something we read has gone away; don't remember this run
+        if(!hash_file(*i, hash)) return;
+
+        add_field(md5, *i);
+        add_field(md5, hash);
+        manifest << hash << " " << *i << "\n";
+    }
+
+    std::string        result_key = hex_digest(md5);
+    std::ostringstream result;
+
+    std::string text[NSTREAMS];
+    for(int i = 0; i < NSTREAMS; i++)
+        if(_streams[i]) text[i] = _bufs[i].str();
+
+    result << "c2ffi-result 1\n" << text[0].size() << " " << text[1].size() << " " << text[2].size() << "\n";
+    for(int i = 0; i < NSTREAMS; i++) result << text[i];
+
+    if(!write_file_atomic(path(result_key, ".result"), result.str())) return;
+
+    write_file_atomic(path(_manifest_key, ".manifest"), "c2ffi-manifest 1\n" + result_key + "\n" + manifest.str());
+}
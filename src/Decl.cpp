@@ -42,16 +42,6 @@ void Decl::set_location(clang::CompilerInstance& ci, const clang::Decl* d)
     }
 }
 
-FieldsMixin::~FieldsMixin()
-{
-    for(NameTypeVector::iterator i = _v.begin(); i != _v.end(); i++) delete(*i).second;
-}
-
-FunctionsMixin::~FunctionsMixin()
-{
-    for(FunctionVector::iterator i = _v.begin(); i != _v.end(); i++) delete(*i);
-}
-
 void FieldsMixin::add_field(Name name, Type* t)
 {
     _v.push_back(NameTypePair(name, t));
@@ -60,19 +50,16 @@ void FieldsMixin::add_field(Name name, Type* t)
 void FieldsMixin::add_field(C2FFIASTConsumer* ast, clang::FieldDecl* f)
 {
     clang::ASTContext& ctx       = ast->ci().getASTContext();
-    auto               type_info = ctx.getTypeInfo(f->getTypeSourceInfo()->getType().getTypePtr());
-    Type*              t         = Type::make_type(ast, f->getTypeSourceInfo()->getType().getTypePtr());
-    ;
-
-    if(f->isBitField())
-        t = new BitfieldType(
-            ast->ci(), f->getTypeSourceInfo()->getType().getTypePtr(), f->getBitWidthValue(ctx), t);
+    const clang::Type* ft        = f->getTypeSourceInfo()->getType().getTypePtr();
+    auto               type_info = ctx.getTypeInfo(ft);
+    unsigned           width     = f->isBitField() ? f->getBitWidthValue(ctx) : 0;
+    NameTypePair       field(f->getDeclName().getAsString(), Type::make_field_type(ast, ft, width));
 
-    t->set_bit_offset(ctx.getFieldOffset(f));
-    t->set_bit_size(type_info.Width);
-    t->set_bit_alignment(type_info.Align);
+    field.bit_offset    = ctx.getFieldOffset(f);
+    field.bit_size      = type_info.Width;
+    field.bit_alignment = type_info.Align;
 
-    add_field(f->getDeclName().getAsString(), t);
+    _v.push_back(field);
 }
 
 void FieldsMixin::add_field(C2FFIASTConsumer* ast, clang::ParmVarDecl* p)
@@ -91,7 +78,7 @@ void FunctionsMixin::add_functions(C2FFIASTConsumer* ast, const clang::ObjCConta
 {
     for(clang::ObjCContainerDecl::method_iterator m = d->meth_begin(); m != d->meth_end(); m++) {
         const clang::Type* return_type = m->getReturnType().getTypePtr();
-        FunctionDecl*      f           = new FunctionDecl(
+        FunctionDecl*      f           = ast->arena().make<FunctionDecl>(
             ast, m->getDeclName().getAsString(), Type::make_type(ast, return_type), m->isVariadic(),
             false, clang::SC_None);
 
@@ -113,7 +100,7 @@ void FunctionsMixin::add_functions(C2FFIASTConsumer* ast, const clang::CXXRecord
         const clang::CXXMethodDecl* m           = (*i);
         const clang::Type*          return_type = m->getReturnType().getTypePtr();
 
-        CXXFunctionDecl* f = new CXXFunctionDecl(
+        CXXFunctionDecl* f = ast->arena().make<CXXFunctionDecl>(
             ast, m->getDeclName().getAsString(), Type::make_type(ast, return_type), m->isVariadic(),
             m->isInlineSpecified(), m->getStorageClass());
 
@@ -20,6 +20,7 @@
 */
 
 #include <map>
+#include <memory>
 #include <set>
 #include <sstream>
 #include <string>
@@ -28,8 +29,11 @@
 #include <clang/Lex/MacroInfo.h>
 #include <clang/Lex/Preprocessor.h>
 #include <clang/Lex/Token.h>
+#include <llvm/Support/TimeProfiler.h>
 
 #include "c2ffi.h"
+#include "c2ffi/filter.h"
+#include "c2ffi/symbols.h"
 #include "c2ffi/macros.h"
 
 typedef std::set<std::string>              StringSet;
@@ -181,30 +185,52 @@ static void output_redef(
         default: os << "char*"; break;
     }
 
-    os << " __c2ffi_" << name << " = " << name << ";" << std::endl;
+    os << " __c2ffi_" << name << " = " << name << ";\n";
 }
 
-void c2ffi::process_macros(clang::CompilerInstance& ci, std::ostream& os, const config& config)
+static void write_macros(clang::CompilerInstance& ci, std::ostream& os, const c2ffi::config& config, bool with_defs)
 {
-    using namespace c2ffi;
-
     clang::SourceManager& sm = ci.getSourceManager();
     clang::Preprocessor&  pp = ci.getPreprocessor();
 
+    std::unique_ptr<c2ffi::LocationFilter> filter;
+    if(c2ffi::LocationFilter::active(config)) filter.reset(new c2ffi::LocationFilter(sm, config));
+
+    // Macros aren't part of the type graph, so --symbols only keeps the
+    // ones it names
+    std::unique_ptr<c2ffi::SymbolSet> symbols;
+    if(c2ffi::SymbolSet::active(config)) symbols.reset(new c2ffi::SymbolSet(config));
+
     for(clang::Preprocessor::macro_iterator i = pp.macro_begin(); i != pp.macro_end(); i++) {
-        const clang::MacroInfo*     mi   = i->getSecond().getLatest()->getMacroInfo();
-        const clang::SourceLocation sl   = mi->getDefinitionLoc();
-        std::string                 loc  = sl.printToString(sm);
-        const char*                 name = (*i).first->getNameStart();
+        const clang::MacroInfo*     mi = i->getSecond().getLatest()->getMacroInfo();
+        const clang::SourceLocation sl = mi->getDefinitionLoc();
+
+        if(filter && !filter->wanted(sl)) continue;
+
+        std::string loc  = sl.printToString(sm);
+        const char* name = (*i).first->getNameStart();
+
+        if(symbols && !symbols->matches(name)) continue;
 
         if(mi->isBuiltinMacro() || loc.substr(0, 10) == "<built-in>") {
         } else if(mi->isFunctionLike()) {
         } else if(best_guess type = macro_type(ci, pp, name, mi)) {
-            if (config.with_macro_defs) {
-                os << std::endl << "/* " << loc << " */" << std::endl;
-                os << "#define " << name << " " << macro_to_string(pp, mi) << std::endl;
+            if (with_defs) {
+                os << "\n/* " << loc << " */\n";
+                os << "#define " << name << " " << macro_to_string(pp, mi) << '\n';
             }
             output_redef(pp, name, mi, type, os);
         }
     }
 }
+
+void c2ffi::process_macros(clang::CompilerInstance& ci, std::ostream& os, const config& config)
+{
+    llvm::TimeTraceScope trace("process_macros");
+    write_macros(ci, os, config, config.with_macro_defs);
+}
+
+void c2ffi::write_macro_redefs(clang::CompilerInstance& ci, std::ostream& os, const config& config)
+{
+    write_macros(ci, os, config, false);
+}
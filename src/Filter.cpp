@@ -0,0 +1,98 @@
+/*
+    c2ffi
+    Copyright (C) 2013  Ryan Pavlik
+
+    This file is part of c2ffi.
+
+    c2ffi is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    c2ffi is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with c2ffi.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string>
+
+#include <llvm/Support/Error.h>
+
+#include <clang/Basic/SourceManager.h>
+
+#include "c2ffi/filter.h"
+#include "c2ffi/opt.h"
+
+using namespace c2ffi;
+
+bool c2ffi::valid_glob(const std::string& pattern)
+{
+    llvm::Expected<llvm::GlobPattern> glob = llvm::GlobPattern::create(pattern);
+
+    if(glob) return true;
+
+    llvm::consumeError(glob.takeError());
+    return false;
+}
+
+static void add_globs(std::vector<llvm::GlobPattern>& globs, const IncludeVector& patterns)
+{
+    for(IncludeVector::const_iterator i = patterns.begin(); i != patterns.end(); ++i) {
+        llvm::Expected<llvm::GlobPattern> glob = llvm::GlobPattern::create(*i);
+
+        // Already checked by process_args()
+        if(glob)
+            globs.push_back(std::move(*glob));
+        else
+            llvm::consumeError(glob.takeError());
+    }
+}
+
+LocationFilter::LocationFilter(clang::SourceManager& sm, const config& c) : _sm(sm), _main_only(c.main_only)
+{
+    add_globs(_only, c.only_from);
+    add_globs(_exclude, c.exclude_from);
+}
+
+bool LocationFilter::active(const config& c)
+{
+    return c.main_only || !c.only_from.empty() || !c.exclude_from.empty();
+}
+
+bool LocationFilter::match(clang::FileID fid) const
+{
+    llvm::StringRef path = fid.isValid() ? _sm.getFilename(_sm.getLocForStartOfFile(fid)) : "";
+
+    for(std::vector<llvm::GlobPattern>::const_iterator i = _exclude.begin(); i != _exclude.end(); ++i)
+        if(i->match(path)) return false;
+
+    // Without either, everything not excluded
+    if(!_main_only && _only.empty()) return true;
+
+    if(_main_only && fid.isValid() && fid == _sm.getMainFileID()) return true;
+
+    for(std::vector<llvm::GlobPattern>::const_iterator i = _only.begin(); i != _only.end(); ++i)
+        if(i->match(path)) return true;
+
+    return false;
+}
+
+bool LocationFilter::wanted(clang::SourceLocation loc)
+{
+    // Builtins and other decls with no location; FileID() is also the
+    // map's empty key
+    if(loc.isInvalid()) return match(clang::FileID());
+
+    clang::FileID fid = _sm.getFileID(_sm.getExpansionLoc(loc));
+
+    llvm::DenseMap<clang::FileID, bool>::iterator i = _files.find(fid);
+    if(i != _files.end()) return i->second;
+
+    bool wanted = match(fid);
+    _files[fid] = wanted;
+    return wanted;
+}
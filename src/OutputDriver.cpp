@@ -20,26 +20,85 @@
 
 #include <stdarg.h>
 #include <stdio.h>
+#include <errno.h>
+#include <string.h>
 #include "c2ffi.h"
+#include "c2ffi/sink.h"
 
 /*** Add new OutputDrivers here: ***************************************/
 
 namespace c2ffi {
     OutputDriver* MakeNullOutputDriver(std::ostream *os);
     OutputDriver* MakeJSONOutputDriver(std::ostream *os);
+    OutputDriver* MakeJSONLinesOutputDriver(std::ostream *os);
     OutputDriver* MakeSexpOutputDriver(std::ostream *os);
+    OutputDriver* MakeCBOROutputDriver(std::ostream *os);
 
     OutputDriverField OutputDrivers[] = {
         { "json", &MakeJSONOutputDriver },
+        { "json-lines", &MakeJSONLinesOutputDriver },
         { "sexp", &MakeSexpOutputDriver },
+        { "cbor", &MakeCBOROutputDriver, true },
         { "null", &MakeNullOutputDriver },
         { 0, 0 }
     };
+
+    OutputDriver* MakeMultiOutputDriver(std::ostream *os,
+                                        const std::vector<OutputDriver*> &drivers,
+                                        const std::vector<FdStream*> &streams,
+                                        const std::vector<std::string> &paths);
 }
 
 /***********************************************************************/
 
 namespace c2ffi {
+    const OutputDriverField* find_output_driver(const std::string &name) {
+        for(int i = 0; OutputDrivers[i].name; i++)
+            if(name == OutputDrivers[i].name)
+                return &OutputDrivers[i];
+
+        return NULL;
+    }
+
+    OutputDriver* make_output_driver(const OutputDriverSpecVector &specs,
+                                     std::ostream *os, bool async) {
+        if(specs.size() == 1 && specs[0].path.empty())
+            return specs[0].driver->fn(os);
+
+        std::vector<OutputDriver*> drivers;
+        std::vector<FdStream*> streams;
+        std::vector<std::string> paths;
+
+        for(OutputDriverSpecVector::const_iterator i = specs.begin();
+            i != specs.end(); ++i) {
+            std::ostream *out = os;
+
+            if(!i->path.empty()) {
+                FdStream *of = FdStream::open(i->path, async);
+
+                if(!of) {
+                    std::cerr << "Error: Could not open output file: "
+                              << i->path << ": " << strerror(errno) << std::endl;
+                    out = NULL;
+                } else {
+                    streams.push_back(of);
+                    paths.push_back(i->path);
+                    out = of;
+                }
+            }
+
+            if(!out) {
+                for(size_t j = 0; j < drivers.size(); j++) delete drivers[j];
+                for(size_t j = 0; j < streams.size(); j++) delete streams[j];
+                return NULL;
+            }
+
+            drivers.push_back(i->driver->fn(out));
+        }
+
+        return MakeMultiOutputDriver(os, drivers, streams, paths);
+    }
+
     void OutputDriver::comment(char *fmt, ...) {
         va_list ap;
         char buf[1024];
@@ -0,0 +1,576 @@
+/*
+    c2ffi
+    Copyright (C) 2013  Ryan Pavlik
+
+    This file is part of c2ffi.
+
+    c2ffi is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    c2ffi is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with c2ffi.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <atomic>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <iostream>
+#include <set>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <sys/stat.h>
+
+#include <llvm/ADT/IntrusiveRefCntPtr.h>
+#include <llvm/ADT/SmallString.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/Path.h>
+#include <llvm/Support/TimeProfiler.h>
+#include <llvm/Support/raw_os_ostream.h>
+
+#include <clang/AST/ASTConsumer.h>
+#include <clang/AST/ASTContext.h>
+#include <clang/Basic/Diagnostic.h>
+#include <clang/Basic/FileManager.h>
+#include <clang/Basic/FileSystemOptions.h>
+#include <clang/Basic/SourceManager.h>
+#include <clang/Frontend/CompilerInstance.h>
+#include <clang/Frontend/FrontendActions.h>
+#include <clang/Frontend/Utils.h>
+#include <clang/Lex/HeaderSearch.h>
+#include <clang/Lex/PPCallbacks.h>
+#include <clang/Lex/Preprocessor.h>
+#include <clang/Lex/PreprocessorOptions.h>
+#include <clang/Parse/ParseAST.h>
+#include <clang/Parse/Parser.h>
+#include <clang/Sema/Sema.h>
+
+#include "c2ffi.h"
+#include "c2ffi/ast.h"
+#include "c2ffi/cache.h"
+#include "c2ffi/filter.h"
+#include "c2ffi/init.h"
+#include "c2ffi/macros.h"
+#include "c2ffi/opt.h"
+#include "c2ffi/process.h"
+#include "c2ffi/shard.h"
+#include "c2ffi/sink.h"
+#include "c2ffi/stats.h"
+#include "c2ffi/symbols.h"
+
+using namespace c2ffi;
+
+namespace {
+    // clang's collector skips system headers by default; we want every
+    // file that contributed to the output.
+    class AllDependencyCollector : public clang::DependencyCollector {
+    public:
+        bool needSystemDependencies() override { return true; }
+    };
+
+    // What #include and __has_include looked for, for lookup_dirs()
+    struct Lookups {
+        // Every leading directory of a name, and ""
+        std::set<std::string> subdirs;
+
+        // Those of "" names, joined to the includer's directory
+        std::set<std::string> local;
+    };
+
+    class LookupCallbacks : public clang::PPCallbacks {
+        clang::SourceManager& _sm;
+        Lookups&              _lookups;
+
+        void add(clang::SourceLocation loc, llvm::StringRef name, bool angled)
+        {
+            llvm::StringRef includer = angled ? "" : llvm::sys::path::parent_path(_sm.getFilename(loc));
+
+            for(llvm::StringRef dir = llvm::sys::path::parent_path(name);; dir = llvm::sys::path::parent_path(dir)) {
+                _lookups.subdirs.insert(dir.str());
+
+                if(!includer.empty()) {
+                    llvm::SmallString<256> path(includer);
+                    llvm::sys::path::append(path, dir);
+                    _lookups.local.insert(path.str().str());
+                }
+
+                if(dir.empty()) break;
+            }
+        }
+
+    public:
+        LookupCallbacks(clang::SourceManager& sm, Lookups& lookups) : _sm(sm), _lookups(lookups) { }
+
+        void InclusionDirective(
+            clang::SourceLocation hash_loc,
+            const clang::Token&,
+            llvm::StringRef               name,
+            bool                          angled,
+            clang::CharSourceRange,
+            clang::OptionalFileEntryRef,
+            llvm::StringRef,
+            llvm::StringRef,
+            const clang::Module*,
+            clang::SrcMgr::CharacteristicKind) override
+        {
+            add(hash_loc, name, angled);
+        }
+
+        void HasInclude(
+            clang::SourceLocation loc,
+            llvm::StringRef       name,
+            bool                  angled,
+            clang::OptionalFileEntryRef,
+            clang::SrcMgr::CharacteristicKind) override
+        {
+            add(loc, name, angled);
+        }
+    };
+}
+
+/* Every directory whose contents decided where a header was found, or
+   that there was none: each search path entry joined to each leading
+   directory of the names looked for, and the same for "" names from
+   the includer's directory.  A header added to any of these changes
+   its mtime. */
+static IncludeVector lookup_dirs(clang::CompilerInstance& ci, const Lookups& lookups)
+{
+    std::set<std::string> dirs(lookups.local);
+
+    for(const clang::DirectoryLookup& d : ci.getPreprocessor().getHeaderSearchInfo().search_dir_range()) {
+        for(const std::string& sub : lookups.subdirs) {
+            llvm::SmallString<256> path(d.getName());
+            llvm::sys::path::append(path, sub);
+            dirs.insert(path.str().str());
+        }
+    }
+
+    return IncludeVector(dirs.begin(), dirs.end());
+}
+
+// Make treats spaces, '#' and '$' specially in file names
+static std::string make_escape(const std::string& path)
+{
+    std::string s;
+
+    for(std::string::const_iterator i = path.begin(); i != path.end(); ++i) {
+        if(*i == ' ' || *i == '#')
+            s += '\\';
+        else if(*i == '$')
+            s += '$';
+        s += *i;
+    }
+
+    return s;
+}
+
+static void write_depfile(const config& sys, const IncludeVector& deps)
+{
+    std::ofstream out(sys.depfile);
+
+    if(!out) {
+        std::cerr << "Error: Could not open depfile: " << sys.depfile << std::endl;
+        return;
+    }
+
+    for(IncludeVector::const_iterator i = sys.dep_targets.begin(); i != sys.dep_targets.end(); ++i)
+        out << (i == sys.dep_targets.begin() ? "" : " ") << make_escape(*i);
+    out << ":";
+
+    for(IncludeVector::const_iterator i = deps.begin(); i != deps.end(); ++i) out << " \\\n  " << make_escape(*i);
+    out << "\n";
+}
+
+// Every file on disk the run read
+static IncludeVector input_files(const config& sys, const AllDependencyCollector& deps)
+{
+    IncludeVector files;
+
+    for(const std::string& file : deps.getDependencies())
+        if(!sys.read_stdin || file != sys.filename) files.push_back(file);
+
+    if(!sys.include_pch.empty()) files.push_back(sys.include_pch);
+
+    return files;
+}
+
+// Build a PCH from config.filename instead of producing output.  This
+// uses clang's own action, which recreates the Preprocessor, so include
+// paths go through the HeaderSearchOptions, and dependencies are
+// collected by the CompilerInstance.
+static int emit_pch(config& sys, clang::CompilerInstance& ci)
+{
+    std::shared_ptr<AllDependencyCollector> deps;
+
+    if(!add_include_opts(ci, sys.includes, false, errors(sys)) || !add_include_opts(ci, sys.sys_includes, true, errors(sys)))
+        return 1;
+
+    if(sys.deps || !sys.depfile.empty()) {
+        deps = std::make_shared<AllDependencyCollector>();
+        ci.addDependencyCollector(deps);
+    }
+
+    ci.getPreprocessorOpts().UsePredefines = true;
+    ci.getFrontendOpts().OutputFile        = sys.emit_pch;
+
+    clang::GeneratePCHAction action;
+
+    if(!ci.ExecuteAction(action)) return 1;
+
+    if(deps) {
+        IncludeVector files = input_files(sys, *deps);
+
+        if(!sys.depfile.empty()) write_depfile(sys, files);
+        if(sys.deps) sys.deps->swap(files);
+    }
+
+    return 0;
+}
+
+// Like clang::ParseAST(), but the translation unit is kept open at the
+// end of the main file so the macro redefinitions can be parsed into it
+// and output along with everything else.
+static void parse_with_macro_values(
+    clang::CompilerInstance& ci, C2FFIASTConsumer* astc, const config& sys, LocationFilter* filter)
+{
+    clang::Preprocessor& pp = ci.getPreprocessor();
+
+    ci.createSema(clang::TU_Complete, NULL);
+    clang::Sema& sema = ci.getSema();
+
+    pp.enableIncrementalProcessing();
+    pp.EnterMainSourceFile();
+
+    if(clang::ExternalASTSource* ext = ci.getASTContext().getExternalSource()) ext->StartTranslationUnit(astc);
+
+    clang::Parser parser(pp, sema, ci.getFrontendOpts().SkipFunctionBodies);
+    parser.Initialize();
+
+    clang::EnterExpressionEvaluationContext eval(sema, clang::Sema::ExpressionEvaluationContext::PotentiallyEvaluated);
+    clang::Parser::DeclGroupPtrTy         group;
+    clang::Sema::ModuleImportState        state;
+
+    for(bool eof = parser.ParseFirstTopLevelDecl(group, state); !eof; eof = parser.ParseTopLevelDecl(group, state))
+        if(group) astc->HandleTopLevelDecl(group.get());
+
+    std::ostringstream redefs;
+    write_macro_redefs(ci, redefs, sys);
+
+    clang::FileID fid = ci.getSourceManager().createFileID(
+        llvm::MemoryBuffer::getMemBufferCopy(redefs.str(), "<c2ffi macros>"));
+    pp.EnterSourceFile(fid, NULL, clang::SourceLocation());
+
+    // The macros were already filtered by where they were defined
+    if(filter) filter->allow(fid);
+
+    if(parser.getCurToken().is(clang::tok::annot_repl_input_end)) parser.ConsumeAnyToken();
+
+    // Not every macro is a constant expression; those redefinitions
+    // just fail, quietly, as they would in a separate run.
+    ci.getDiagnostics().setSuppressAllDiagnostics(true);
+
+    while(!parser.ParseTopLevelDecl(group, state)) {
+        if(!group) continue;
+
+        StatsTimer timer(astc->stats(), Stats::CONVERT);
+
+        for(clang::DeclGroupRef::iterator i = group.get().begin(); i != group.get().end(); ++i)
+            if(!(*i)->isInvalidDecl()) astc->HandleMacroDecl(*i);
+    }
+
+    ci.getDiagnostics().setSuppressAllDiagnostics(false);
+
+    pp.enableIncrementalProcessing(false);
+    sema.ActOnEndOfTranslationUnit();
+
+    for(clang::Decl* d : sema.WeakTopLevelDecls()) astc->HandleTopLevelDecl(clang::DeclGroupRef(d));
+
+    astc->HandleTranslationUnit(ci.getASTContext());
+}
+
+static bool load_pch(clang::CompilerInstance& ci, const config& sys)
+{
+    ci.createPCHExternalASTSource(sys.include_pch, clang::DisableValidationForModuleKind::None, false, NULL, false);
+
+    if(ci.getASTContext().getExternalSource()) return true;
+
+    errors(sys) << "Error: Could not load PCH: " << sys.include_pch << "\n";
+    return false;
+}
+
+int c2ffi::process_file(config& sys, clang::FileManager* fm)
+{
+    std::unique_ptr<Stats>                  stats;
+    std::unique_ptr<AllDependencyCollector> deps;
+    std::unique_ptr<CacheEntry>             cache;
+    std::unique_ptr<ShardCache>             shards;
+    std::unique_ptr<LocationFilter>         filter;
+    std::unique_ptr<SymbolSet>              symbols;
+    std::unique_ptr<TypeTable>              types;
+    clang::CompilerInstance                 ci;
+    llvm::TimeTraceScope                    trace("process_file", sys.filename);
+    int                                     result = 0;
+    Lookups                                 lookups;
+
+    if(!sys.stats_format.empty()) stats.reset(new Stats(sys));
+
+    if(CacheEntry::usable(sys)) {
+        cache.reset(new CacheEntry(sys));
+
+        if(cache->replay()) {
+            if(!sys.depfile.empty()) write_depfile(sys, cache->deps());
+            if(sys.macro_output) sys.macro_output->close();
+            if(sys.template_output) sys.template_output->close();
+            sys.output->flush();
+            return 0;
+        }
+
+        cache->capture();
+    }
+
+    StatsTimer init_timer(sys.stats, Stats::INIT);
+
+    // this finishes parsing the arguments using clang
+    if(!init_ci(sys, ci, fm)) return 1;
+
+    if(!sys.emit_pch.empty()) return emit_pch(sys, ci);
+
+    if(sys.deps || cache || !sys.depfile.empty()) {
+        deps.reset(new AllDependencyCollector);
+        deps->attachToPreprocessor(ci.getPreprocessor());
+    }
+
+    if(sys.lookup_dirs)
+        ci.getPreprocessor().addPPCallbacks(std::make_unique<LookupCallbacks>(ci.getSourceManager(), lookups));
+
+    if(ShardCache::usable(sys)) shards.reset(new ShardCache(ci, sys));
+    if(LocationFilter::active(sys)) filter.reset(new LocationFilter(ci.getSourceManager(), sys));
+    if(SymbolSet::active(sys)) symbols.reset(new SymbolSet(sys));
+    if(sys.type_table) types.reset(new TypeTable);
+
+    if(!add_includes(ci, sys.includes, false, &errors(sys)) || !add_includes(ci, sys.sys_includes, true, &errors(sys)))
+        return 1;
+
+    C2FFIASTConsumer* astc = NULL;
+
+    const clang::FileEntry* file;
+
+    if(sys.read_stdin) {
+        clang::FileEntryRef fe = ci.getFileManager().getVirtualFileRef(sys.filename, sys.input_data.size(), 0);
+        ci.getSourceManager().overrideFileContents(fe, llvm::MemoryBuffer::getMemBufferCopy(sys.input_data, sys.filename));
+        file = &fe.getFileEntry();
+    } else {
+        file = ci.getFileManager().getFile(sys.filename).get();
+    }
+
+    clang::FileID fid = ci.getSourceManager().createFileID(file, clang::SourceLocation(), clang::SrcMgr::C_User);
+    ci.getSourceManager().setMainFileID(fid);
+    ci.getDiagnosticClient().BeginSourceFile(ci.getLangOpts(), &ci.getPreprocessor());
+
+    if(sys.preprocess_only) {
+        init_timer.stop();
+        StatsTimer timer(sys.stats, Stats::PREPROCESS);
+
+        llvm::raw_ostream* os = new llvm::raw_os_ostream(*sys.output);
+        clang::DoPrintPreprocessedInput(ci.getPreprocessor(), os, ci.getPreprocessorOutputOpts());
+        delete os;
+    } else {
+        astc = new C2FFIASTConsumer(ci, sys);
+        astc->set_shards(shards.get());
+        astc->set_filter(filter.get());
+        astc->set_symbols(symbols.get());
+        astc->set_type_table(types.get());
+        ci.setASTConsumer(std::unique_ptr<clang::ASTConsumer>(astc));
+        ci.createASTContext();
+
+        if(!sys.include_pch.empty() && !load_pch(ci, sys)) result = 1;
+
+        init_timer.stop();
+    }
+
+    if(astc && !result) {
+        sys.od->write_header();
+
+        if(sys.to_namespace != "") sys.od->write_namespace(sys.to_namespace);
+
+        {
+            StatsTimer           timer(sys.stats, Stats::PARSE);
+            llvm::TimeTraceScope trace("ParseAST");
+
+            if(sys.macro_values)
+                parse_with_macro_values(ci, astc, sys, filter.get());
+            else
+                clang::ParseAST(ci.getPreprocessor(), astc, ci.getASTContext(), false, clang::TU_Complete, NULL,
+                                ci.getFrontendOpts().SkipFunctionBodies);
+        }
+
+        if(sys.stats)
+            sys.stats->ast_bytes =
+                ci.getASTContext().getASTAllocatedMemory() + ci.getASTContext().getSideTableAllocatedMemory();
+
+        {
+            StatsTimer timer(sys.stats, Stats::WRITE);
+
+            astc->PostProcess();
+            sys.od->write_footer();
+            sys.od->flush();
+        }
+
+        if(sys.macro_output) {
+            StatsTimer timer(sys.stats, Stats::MACROS);
+            process_macros(ci, *sys.macro_output, sys);
+        }
+
+        if(shards && !ci.getDiagnostics().hasErrorOccurred()) shards->save();
+
+        // Output is only passed on once the entry is finished with, and
+        // must be before the files are closed
+        if(cache && !ci.getDiagnostics().hasErrorOccurred())
+            cache->store(input_files(sys, *deps));
+        cache.reset();
+
+        if(sys.macro_output) sys.macro_output->close();
+
+        if(sys.template_output) sys.template_output->close();
+    }
+
+    ci.getDiagnosticClient().EndSourceFile();
+    sys.output->flush();
+
+    if(result) return result;
+
+    if(deps) {
+        IncludeVector files = input_files(sys, *deps);
+
+        if(!sys.depfile.empty()) write_depfile(sys, files);
+        if(sys.deps) sys.deps->swap(files);
+    }
+
+    if(sys.lookup_dirs) *sys.lookup_dirs = lookup_dirs(ci, lookups);
+
+    if(sys.fail_on_error && ci.getDiagnostics().hasErrorOccurred()) return 1;
+    return 0;
+}
+
+typedef std::pair<std::string, std::string> BatchJob;
+typedef std::vector<BatchJob>               BatchJobVector;
+
+static bool read_batch_file(const config& sys, BatchJobVector& jobs)
+{
+    std::ifstream in(sys.batch_file);
+
+    if(!in) {
+        std::cerr << "Error: Could not open batch file: " << sys.batch_file << std::endl;
+        return false;
+    }
+
+    std::string line;
+    while(std::getline(in, line)) {
+        std::istringstream ss(line);
+        std::string        input, output;
+
+        if(!(ss >> input) || input[0] == '#') continue;
+
+        if(!(ss >> output)) output = input + "." + sys.drivers[0].driver->name;
+
+        jobs.push_back(BatchJob(input, output));
+    }
+
+    return true;
+}
+
+static int process_job(const config& sys, const BatchJob& job, clang::FileManager* fm)
+{
+    struct stat buf;
+    if(stat(job.first.c_str(), &buf) < 0 || !S_ISREG(buf.st_mode)) {
+        std::cerr << "Error: Not a regular file: " << job.first << std::endl;
+        return 1;
+    }
+
+    FdStream* of = FdStream::open(job.second, sys.async_output);
+    if(!of) {
+        std::cerr << "Error: Could not open output file: " << job.second << std::endl;
+        return 1;
+    }
+
+    config c   = sys;
+    c.filename = job.first;
+    c.output   = of;
+    c.od       = make_output_driver(sys.drivers, of, sys.async_output);
+
+    if(!c.od) {
+        delete of;
+        return 1;
+    }
+
+    int result = process_file(c, fm);
+
+    if(!c.od->close()) result = 1;
+    delete c.od;
+
+    if(!of->close()) {
+        std::cerr << "Error: Could not write output file: " << job.second << std::endl;
+        result = 1;
+    }
+    delete of;
+
+    return result;
+}
+
+// Each worker pulls the next job until none are left.  FileManager
+// isn't thread-safe, so every worker keeps its own, shared between the
+// inputs that worker happens to process.
+static void run_worker(const config& sys, const BatchJobVector& jobs, std::atomic<size_t>& next, std::atomic<int>& result)
+{
+    llvm::IntrusiveRefCntPtr<clang::FileManager> fm(new clang::FileManager(clang::FileSystemOptions()));
+
+    for(size_t n = next++; n < jobs.size(); n = next++)
+        if(process_job(sys, jobs[n], fm.get())) result = 1;
+}
+
+// The profiler is per thread; each extra worker's events are handed
+// over when it's done, for main() to write along with its own.
+static void run_thread(const config& sys, const BatchJobVector& jobs, std::atomic<size_t>& next, std::atomic<int>& result)
+{
+    if(!sys.time_trace.empty()) llvm::timeTraceProfilerInitialize(sys.time_trace_granularity, "c2ffi");
+
+    run_worker(sys, jobs, next, result);
+
+    if(!sys.time_trace.empty()) llvm::timeTraceProfilerFinishThread();
+}
+
+int c2ffi::process_batch(config& sys)
+{
+    BatchJobVector jobs;
+
+    if(!read_batch_file(sys, jobs)) return 1;
+
+    size_t nworkers = sys.jobs;
+    if(nworkers == 0) nworkers = std::thread::hardware_concurrency();
+    if(nworkers == 0) nworkers = 1;
+    if(nworkers > jobs.size()) nworkers = jobs.size();
+
+    std::atomic<size_t>      next(0);
+    std::atomic<int>         result(0);
+    std::vector<std::thread> workers;
+
+    for(size_t i = 1; i < nworkers; i++)
+        workers.push_back(std::thread(run_thread, std::cref(sys), std::cref(jobs), std::ref(next), std::ref(result)));
+
+    run_worker(sys, jobs, next, result);
+
+    for(std::vector<std::thread>::iterator i = workers.begin(); i != workers.end(); ++i) i->join();
+
+    return result;
+}
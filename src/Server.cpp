@@ -0,0 +1,369 @@
+/*
+    c2ffi
+    Copyright (C) 2013  Ryan Pavlik
+
+    This file is part of c2ffi.
+
+    c2ffi is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    c2ffi is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with c2ffi.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+   Server protocol: a client connects to the socket and sends one
+   request as "key value" lines, ended by an empty line:
+
+       file /path/to/header.h
+       include /some/dir
+       driver sexp
+
+   Recognized keys are file, include, sys-include, driver, arch, lang,
+   std, namespace and include-pch; include and sys-include may be
+   repeated and add to any given on the command line.  The server
+   answers "OK" and the driver output, or "ERROR <message>" followed by
+   any diagnostics, and closes the connection.  A request identical to
+   an earlier one is answered from memory while none of the files it
+   read have changed.
+ */
+
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <streambuf>
+#include <string>
+#include <utility>
+
+#include <errno.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <llvm/ADT/IntrusiveRefCntPtr.h>
+#include <llvm/Support/raw_ostream.h>
+
+#include <clang/Basic/FileManager.h>
+#include <clang/Basic/FileSystemOptions.h>
+
+#include "c2ffi.h"
+#include "c2ffi/init.h"
+#include "c2ffi/opt.h"
+#include "c2ffi/process.h"
+
+using namespace c2ffi;
+
+namespace {
+    // Buffered std::streambuf writing to a connected socket
+    class SocketBuf : public std::streambuf {
+        int  _fd;
+        char _buf[65536];
+
+        bool send_all(const char* p, size_t n)
+        {
+            while(n > 0) {
+                ssize_t r = send(_fd, p, n, MSG_NOSIGNAL);
+                if(r < 0) {
+                    if(errno == EINTR) continue;
+                    return false;
+                }
+                p += r;
+                n -= r;
+            }
+            return true;
+        }
+
+    protected:
+        int overflow(int c) override
+        {
+            if(sync() < 0) return traits_type::eof();
+            if(c != traits_type::eof()) {
+                *pptr() = c;
+                pbump(1);
+            }
+            return traits_type::not_eof(c);
+        }
+
+        int sync() override
+        {
+            bool ok = send_all(pbase(), pptr() - pbase());
+            setp(_buf, _buf + sizeof(_buf));
+            return ok ? 0 : -1;
+        }
+
+    public:
+        SocketBuf(int fd) : _fd(fd) { setp(_buf, _buf + sizeof(_buf)); }
+        ~SocketBuf() { sync(); }
+    };
+
+    typedef std::map<std::string, std::pair<off_t, time_t> > FileStatMap;
+    typedef std::map<std::string, std::string> ReplyMap;
+
+    // What's kept between requests; only valid while files are unchanged
+    struct ServerState {
+        llvm::IntrusiveRefCntPtr<clang::FileManager> fm;
+        FileStatMap files;
+
+        // Output for each request answered since, by request text
+        ReplyMap replies;
+
+        ServerState() { reset(); }
+
+        void reset()
+        {
+            fm = new clang::FileManager(clang::FileSystemOptions());
+            files.clear();
+            replies.clear();
+        }
+    };
+}
+
+// How long a client may take to send its request or read the reply
+static const int CLIENT_TIMEOUT = 30;
+
+// Gives up after CLIENT_TIMEOUT, even if the client keeps sending a
+// little at a time; the socket's own timeout covers each read
+static bool read_request(int fd, std::string& request)
+{
+    char   buf[4096];
+    time_t deadline = time(NULL) + CLIENT_TIMEOUT;
+
+    while(request.find("\n\n") == std::string::npos) {
+        if(time(NULL) > deadline) return false;
+
+        ssize_t n = read(fd, buf, sizeof(buf));
+        if(n < 0 && errno == EINTR) continue;
+        if(n <= 0) return false;
+        request.append(buf, n);
+    }
+
+    return true;
+}
+
+static bool parse_request(const std::string& request, config& c, std::string& error)
+{
+    std::istringstream in(request);
+    std::string        line;
+
+    while(std::getline(in, line) && !line.empty()) {
+        std::string::size_type sp    = line.find(' ');
+        std::string            key   = line.substr(0, sp);
+        std::string            value = sp == std::string::npos ? "" : line.substr(sp + 1);
+
+        if(key == "file")
+            c.filename = value;
+        else if(key == "include")
+            c.includes.push_back(value);
+        else if(key == "sys-include")
+            c.sys_includes.push_back(value);
+        else if(key == "namespace")
+            c.to_namespace = value;
+        else if(key == "arch")
+            c.arch = value;
+        else if(key == "lang")
+            c.lang = value;
+        else if(key == "include-pch")
+            c.include_pch = value;
+        else if(key == "std") {
+            c.std = parseStd(value);
+            if(c.std == clang::LangStandard::lang_unspecified) {
+                error = "unknown standard: " + value;
+                return false;
+            }
+        } else if(key == "driver") {
+            OutputDriverSpec spec;
+            spec.driver = find_output_driver(value);
+            if(!spec.driver) {
+                error = "invalid output driver: " + value;
+                return false;
+            }
+            c.drivers.assign(1, spec);
+        } else {
+            error = "unknown request key: " + key;
+            return false;
+        }
+    }
+
+    struct stat buf;
+    if(c.filename.empty()) {
+        error = "no file specified";
+        return false;
+    } else if(stat(c.filename.c_str(), &buf) < 0 || !S_ISREG(buf.st_mode)) {
+        error = "not a regular file: " + c.filename;
+        return false;
+    }
+
+    return true;
+}
+
+// The FileManager caches stat results, including failed ones, so it
+// can only be kept while none of the files the last request read, nor
+// the directories it searched, have changed on disk.  A path that did
+// not exist is remembered with a size of -1.
+static bool files_unchanged(const FileStatMap& files)
+{
+    for(FileStatMap::const_iterator i = files.begin(); i != files.end(); ++i) {
+        struct stat buf;
+        if(stat(i->first.c_str(), &buf) < 0) {
+            if(i->second.first != -1) return false;
+            continue;
+        }
+        if(buf.st_size != i->second.first || buf.st_mtime != i->second.second) return false;
+    }
+
+    return true;
+}
+
+static void remember_files(const IncludeVector& paths, FileStatMap& files)
+{
+    for(IncludeVector::const_iterator i = paths.begin(); i != paths.end(); ++i) {
+        struct stat buf;
+        if(stat(i->c_str(), &buf) == 0)
+            files[*i] = std::make_pair(buf.st_size, buf.st_mtime);
+        else
+            files[*i] = std::make_pair(off_t(-1), time_t(0));
+    }
+}
+
+// Only output that goes entirely to the client can be replayed
+static bool replayable(const config& c)
+{
+    return c.drivers.size() == 1 && c.drivers[0].path.empty() && !c.macro_output && !c.template_output
+           && c.depfile.empty();
+}
+
+static void serve_client(int fd, const config& sys, ServerState& state)
+{
+    std::string  request, error;
+    SocketBuf    buf(fd);
+    std::ostream os(&buf);
+    config       c = sys;
+
+    if(!read_request(fd, request)) return;
+    request.erase(request.find("\n\n") + 2);
+
+    if(!parse_request(request, c, error)) {
+        os << "ERROR " << error << "\n";
+        return;
+    }
+
+    if(!files_unchanged(state.files)) state.reset();
+
+    ReplyMap::const_iterator reply = state.replies.find(request);
+    if(reply != state.replies.end()) {
+        os << "OK\n" << reply->second;
+        return;
+    }
+
+    // Nothing is sent until the result is known
+    IncludeVector      deps, dirs;
+    std::ostringstream out;
+    std::string        diag_text;
+    llvm::raw_string_ostream diag(diag_text);
+
+    c.output      = &out;
+    c.od          = make_output_driver(c.drivers, &out, false);
+    c.deps        = &deps;
+    c.lookup_dirs = &dirs;
+    c.diag        = &diag;
+
+    if(!c.od) {
+        os << "ERROR could not open output files\n";
+        return;
+    }
+
+    int result = process_file(c, state.fm.get());
+
+    if(!c.od->close()) result = 1;
+    delete c.od;
+
+    if(result) {
+        os << "ERROR could not process " << c.filename << "\n" << diag.str();
+
+        // Whatever a failed request looked up was not recorded
+        state.reset();
+        return;
+    }
+
+    os << "OK\n" << out.str();
+    os.flush();
+
+    remember_files(deps, state.files);
+    remember_files(dirs, state.files);
+    if(!c.include_pch.empty()) remember_files(IncludeVector(1, c.include_pch), state.files);
+
+    if(replayable(c)) state.replies[request] = out.str();
+}
+
+int c2ffi::process_serve(config& sys)
+{
+    struct sockaddr_un addr;
+
+    if(sys.serve_socket.size() >= sizeof(addr.sun_path)) {
+        std::cerr << "Error: Socket path too long: " << sys.serve_socket << std::endl;
+        return 1;
+    }
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, sys.serve_socket.c_str(), sizeof(addr.sun_path) - 1);
+
+    int sock = socket(AF_UNIX, SOCK_STREAM, 0);
+    if(sock < 0) {
+        std::cerr << "Error: socket: " << strerror(errno) << std::endl;
+        return 1;
+    }
+
+    // Only ever replace a socket, such as one left by an earlier server
+    struct stat buf;
+    if(lstat(sys.serve_socket.c_str(), &buf) == 0) {
+        if(!S_ISSOCK(buf.st_mode)) {
+            std::cerr << "Error: Not a socket: " << sys.serve_socket << std::endl;
+            close(sock);
+            return 1;
+        }
+
+        unlink(sys.serve_socket.c_str());
+    }
+
+    if(bind(sock, (struct sockaddr*)&addr, sizeof(addr)) < 0 || listen(sock, 16) < 0) {
+        std::cerr << "Error: Could not listen on " << sys.serve_socket << ": " << strerror(errno) << std::endl;
+        close(sock);
+        return 1;
+    }
+
+    ServerState state;
+
+    for(;;) {
+        int fd = accept(sock, NULL, NULL);
+
+        if(fd < 0) {
+            if(errno == EINTR) continue;
+            std::cerr << "Error: accept: " << strerror(errno) << std::endl;
+            break;
+        }
+
+        // A client that stalls only holds up others this long
+        struct timeval timeout = { CLIENT_TIMEOUT, 0 };
+        setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+        serve_client(fd, sys, state);
+        close(fd);
+    }
+
+    close(sock);
+    unlink(sys.serve_socket.c_str());
+    return 1;
+}
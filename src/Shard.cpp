@@ -0,0 +1,452 @@
+/*
+    c2ffi
+    Copyright (C) 2013  Ryan Pavlik
+
+    This file is part of c2ffi.
+
+    c2ffi is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    c2ffi is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with c2ffi.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+   Shard file, KEY.shard under --shard-dir:
+
+       c2ffi-shard 2
+       PATH
+       N                          then N "HASH PATH" lines: nested files
+       N                          then N entries, each:
+       EVENTS LENGTH ID DECL      ID: the last id given before it
+       I ID DECL | C 0 DECL       EVENTS lines
+       TEXT                       LENGTH bytes, then a newline
+ */
+
+#include <memory>
+#include <optional>
+#include <sstream>
+#include <string>
+
+#include <llvm/ADT/SmallString.h>
+#include <llvm/Support/ErrorOr.h>
+#include <llvm/Support/MD5.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/raw_ostream.h>
+
+#include <clang/AST/ASTContext.h>
+#include <clang/AST/Decl.h>
+#include <clang/Basic/SourceManager.h>
+#include <clang/Frontend/CompilerInstance.h>
+#include <clang/Lex/MacroInfo.h>
+#include <clang/Lex/PPCallbacks.h>
+#include <clang/Lex/Preprocessor.h>
+
+#include "c2ffi.h"
+#include "c2ffi/cache.h"
+#include "c2ffi/shard.h"
+
+using namespace c2ffi;
+
+namespace {
+    class ShardCallbacks : public clang::PPCallbacks {
+        ShardCache&           _cache;
+        clang::SourceManager& _sm;
+
+    public:
+        ShardCallbacks(ShardCache& cache, clang::SourceManager& sm) : _cache(cache), _sm(sm) { }
+
+        void FileChanged(
+            clang::SourceLocation          loc,
+            FileChangeReason               reason,
+            clang::SrcMgr::CharacteristicKind,
+            clang::FileID                  prev) override
+        {
+            if(reason == EnterFile)
+                _cache.enter(_sm.getFileID(loc));
+            else if(reason == ExitFile)
+                _cache.exit(prev);
+        }
+
+        void MacroDefined(const clang::Token& name, const clang::MacroDirective* md) override
+        {
+            _cache.define(name.getIdentifierInfo(), md->getMacroInfo());
+        }
+
+        void MacroUndefined(
+            const clang::Token& name, const clang::MacroDefinition&, const clang::MacroDirective*) override
+        {
+            _cache.undefine(name.getIdentifierInfo());
+        }
+    };
+}
+
+static void add_field(llvm::MD5& md5, llvm::StringRef s)
+{
+    md5.update(s);
+    md5.update(llvm::StringRef("", 1));
+}
+
+static std::string hex_digest(llvm::MD5& md5)
+{
+    llvm::MD5::MD5Result result;
+    md5.final(result);
+    return result.digest().str().str();
+}
+
+ShardCache::ShardCache(clang::CompilerInstance& ci, const config& c)
+    : _ci(ci), _config(c), _config_key(config_key(c)), _macro_state(0), _recording(NULL)
+{
+    ci.getPreprocessor().addPPCallbacks(std::make_unique<ShardCallbacks>(*this, ci.getSourceManager()));
+}
+
+bool ShardCache::usable(const config& c)
+{
+    return !c.shard_dir.empty() && !c.preprocess_only && c.emit_pch.empty() && !c.template_output
+           && c.drivers.size() == 1 && c.drivers[0].path.empty() && !c.drivers[0].driver->stateful;
+}
+
+std::string ShardCache::shard_path(const std::string& key) const
+{
+    return _config.shard_dir + "/" + key.substr(0, 2) + "/" + key + ".shard";
+}
+
+std::string ShardCache::content_hash(clang::FileID fid)
+{
+    clang::SourceManager&   sm = _ci.getSourceManager();
+    const clang::FileEntry* fe = sm.getFileEntryForID(fid);
+
+    if(fe) {
+        llvm::DenseMap<const clang::FileEntry*, std::string>::iterator i = _file_hashes.find(fe);
+        if(i != _file_hashes.end()) return i->second;
+    }
+
+    std::optional<llvm::StringRef> data = sm.getBufferDataOrNone(fid);
+    llvm::MD5                      md5;
+
+    if(data) md5.update(*data);
+
+    std::string hash = hex_digest(md5);
+    if(fe) _file_hashes[fe] = hash;
+
+    return hash;
+}
+
+void ShardCache::enter(clang::FileID fid)
+{
+    clang::SourceManager& sm = _ci.getSourceManager();
+    OpenFile              f;
+
+    f.fid   = fid;
+    f.path  = sm.getBufferName(sm.getLocForStartOfFile(fid)).str();
+    f.hash  = content_hash(fid);
+    f.shard = NULL;
+
+    _inclusions[fid] = _entered[f.path]++;
+
+    std::string nested = f.hash + " " + f.path;
+
+    for(std::vector<OpenFile>::iterator i = _open.begin(); i != _open.end(); ++i) {
+        Shard* s = i->shard;
+        if(!s) continue;
+
+        if(s->cached && (s->nested.size() >= s->cached_nested.size() || s->cached_nested[s->nested.size()] != nested))
+            s->diverged = true;
+
+        s->nested.push_back(nested);
+    }
+
+    if(fid != sm.getMainFileID() && sm.getFileEntryForID(fid)) {
+        llvm::MD5 md5;
+
+        add_field(md5, _config_key);
+        add_field(md5, std::to_string(_macro_state));
+        add_field(md5, _finished);
+
+        // Each including file counts up to its #include, as what it
+        // declared there can change this header's layout.  Not by path,
+        // so the same text in a different main file still matches.
+        for(size_t i = 0; i < _open.size(); i++) {
+            clang::FileID                  child  = i + 1 < _open.size() ? _open[i + 1].fid : fid;
+            unsigned int                   offset = sm.getDecomposedExpansionLoc(sm.getIncludeLoc(child)).second;
+            std::optional<llvm::StringRef> data   = sm.getBufferDataOrNone(_open[i].fid);
+
+            add_field(md5, data ? data->substr(0, offset) : llvm::StringRef());
+        }
+
+        add_field(md5, f.path);
+        add_field(md5, f.hash);
+
+        Shard& s = _shards[fid];
+        s.key    = hex_digest(md5);
+        s.path   = f.path;
+        load(s);
+
+        f.shard = &s;
+    }
+
+    _open.push_back(f);
+}
+
+void ShardCache::exit(clang::FileID fid)
+{
+    if(_open.empty() || _open.back().fid != fid) return;
+
+    llvm::MD5 md5;
+    add_field(md5, _finished);
+    add_field(md5, _open.back().path);
+    add_field(md5, _open.back().hash);
+    _finished = hex_digest(md5);
+
+    _open.pop_back();
+}
+
+// Macros are kept as an order-independent set: each definition's hash
+// is xor'd in when defined and out when undefined or replaced.
+void ShardCache::define(const clang::IdentifierInfo* ii, const clang::MacroInfo* mi)
+{
+    if(!ii || !mi) return;
+
+    clang::Preprocessor&     pp = _ci.getPreprocessor();
+    llvm::MD5                md5;
+    llvm::MD5::MD5Result     result;
+    llvm::SmallString<64>    buf;
+
+    add_field(md5, ii->getName());
+
+    if(mi->isBuiltinMacro()) {
+        add_field(md5, "<builtin>");
+    } else {
+        add_field(md5, mi->isFunctionLike() ? "(" : "");
+
+        for(const clang::IdentifierInfo* param : mi->params()) add_field(md5, param->getName());
+        for(const clang::Token& t : mi->tokens()) {
+            add_field(md5, t.hasLeadingSpace() ? " " : "");
+            add_field(md5, pp.getSpelling(t, buf));
+        }
+    }
+
+    md5.final(result);
+
+    undefine(ii);
+    _macros[ii] = result.low();
+    _macro_state ^= result.low();
+}
+
+void ShardCache::undefine(const clang::IdentifierInfo* ii)
+{
+    llvm::DenseMap<const clang::IdentifierInfo*, uint64_t>::iterator i = _macros.find(ii);
+    if(i == _macros.end()) return;
+
+    _macro_state ^= i->second;
+    _macros.erase(i);
+}
+
+bool ShardCache::load(Shard& s)
+{
+    llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer> > buf = llvm::MemoryBuffer::getFile(shard_path(s.key));
+    if(!buf) return false;
+
+    std::istringstream in((*buf)->getBuffer().str());
+    std::string        line;
+    size_t             n;
+
+    if(!std::getline(in, line) || line != "c2ffi-shard 2") return false;
+    if(!std::getline(in, line) || line != s.path) return false;
+
+    if(!(in >> n) || in.get() != '\n') return false;
+    for(size_t i = 0; i < n && std::getline(in, line); i++) s.cached_nested.push_back(line);
+
+    if(!(in >> n) || in.get() != '\n') n = 0;
+    for(size_t i = 0; i < n && in; i++) {
+        ShardEntry e;
+        size_t     nevents, length;
+
+        in >> nevents >> length >> e.first_id;
+        in.get();
+        std::getline(in, e.decl);
+
+        for(size_t j = 0; j < nevents && in; j++) {
+            ShardEntry::Event ev;
+
+            in >> ev.kind >> ev.id;
+            in.get();
+            std::getline(in, ev.decl);
+            e.events.push_back(ev);
+        }
+
+        e.text.resize(length);
+        if(length) in.read(&e.text[0], length);
+        in.get();
+
+        s.cached_entries.push_back(e);
+    }
+
+    if(!in || s.cached_entries.size() != n) {
+        s.cached_nested.clear();
+        s.cached_entries.clear();
+        return false;
+    }
+
+    s.cached = true;
+    return true;
+}
+
+std::string ShardCache::file_key(clang::FileID fid) const
+{
+    clang::SourceManager& sm = _ci.getSourceManager();
+    std::string           s  = sm.getBufferName(sm.getLocForStartOfFile(fid)).str();
+
+    llvm::DenseMap<clang::FileID, unsigned int>::const_iterator i = _inclusions.find(fid);
+    if(i != _inclusions.end()) s += "#" + std::to_string(i->second);
+
+    return s;
+}
+
+std::string ShardCache::decl_key(const clang::Decl* d) const
+{
+    clang::SourceManager&    sm  = _ci.getSourceManager();
+    clang::SourceLocation    loc = d->getLocation();
+    std::string              s;
+    llvm::raw_string_ostream os(s);
+
+    os << d->getDeclKindName();
+
+    // Files by name and how many times they were entered before, which
+    // match between runs with the same shard key; scratch space offsets
+    // depend on everything expanded so far, so are left out
+    if(loc.isValid()) {
+        std::pair<clang::FileID, unsigned> e  = sm.getDecomposedExpansionLoc(loc);
+        std::pair<clang::FileID, unsigned> sp = sm.getDecomposedSpellingLoc(loc);
+
+        os << ":" << file_key(e.first) << ":" << e.second;
+        if(sm.getFileEntryForID(sp.first)) os << ":" << file_key(sp.first) << ":" << sp.second;
+    }
+
+    // Template instantiations share their pattern's location
+    if(const clang::NamedDecl* nd = llvm::dyn_cast<clang::NamedDecl>(d)) {
+        os << ":";
+        nd->getNameForDiagnostic(os, _ci.getASTContext().getPrintingPolicy(), true);
+    }
+
+    os.flush();
+    return s;
+}
+
+Shard* ShardCache::shard_for(const clang::Decl* d)
+{
+    clang::SourceManager& sm  = _ci.getSourceManager();
+    clang::SourceLocation loc = d->getLocation();
+
+    if(loc.isInvalid()) return NULL;
+
+    std::map<clang::FileID, Shard>::iterator i = _shards.find(sm.getFileID(sm.getExpansionLoc(loc)));
+    return i == _shards.end() ? NULL : &i->second;
+}
+
+ShardCache::Result ShardCache::begin(const clang::Decl* d, std::string& text, unsigned int& last_id)
+{
+    Shard* s = shard_for(d);
+    if(!s) return UNSHARDED;
+
+    std::string key = decl_key(d);
+
+    if(s->cached && !s->diverged && s->next < s->cached_entries.size() && s->cached_entries[s->next].decl == key
+       && s->cached_entries[s->next].first_id == last_id) {
+        const ShardEntry& e = s->cached_entries[s->next++];
+
+        for(std::vector<ShardEntry::Event>::const_iterator i = e.events.begin(); i != e.events.end(); ++i) {
+            if(i->kind == 'I') {
+                _ids[i->decl] = i->id;
+                if(i->id > last_id) last_id = i->id;
+            } else {
+                _cur.insert(i->decl);
+            }
+        }
+
+        s->entries.push_back(e);
+        text = e.text;
+        return REPLAYED;
+    }
+
+    // From here on this shard is converted as usual
+    s->diverged = true;
+
+    s->entries.push_back(ShardEntry());
+    s->entries.back().decl     = key;
+    s->entries.back().first_id = last_id;
+    _recording                 = &s->entries.back();
+
+    return RECORDING;
+}
+
+void ShardCache::end(const std::string& text)
+{
+    if(_recording) _recording->text = text;
+    _recording = NULL;
+}
+
+void ShardCache::note_id(const clang::Decl* d, unsigned int id)
+{
+    if(!_recording) return;
+
+    ShardEntry::Event ev = { 'I', id, decl_key(d) };
+    _recording->events.push_back(ev);
+}
+
+void ShardCache::note_cur(const clang::Decl* d)
+{
+    if(!_recording) return;
+
+    ShardEntry::Event ev = { 'C', 0, decl_key(d) };
+    _recording->events.push_back(ev);
+}
+
+bool ShardCache::find_id(const clang::Decl* d, unsigned int& id) const
+{
+    if(_ids.empty()) return false;
+
+    std::map<std::string, unsigned int>::const_iterator i = _ids.find(decl_key(d));
+    if(i == _ids.end()) return false;
+
+    id = i->second;
+    return true;
+}
+
+bool ShardCache::find_cur(const clang::Decl* d) const
+{
+    return !_cur.empty() && _cur.count(decl_key(d));
+}
+
+void ShardCache::save()
+{
+    for(std::map<clang::FileID, Shard>::iterator i = _shards.begin(); i != _shards.end(); ++i) {
+        Shard& s = i->second;
+
+        if(s.cached && !s.diverged && s.next == s.cached_entries.size() && s.nested == s.cached_nested) continue;
+
+        std::ostringstream out;
+
+        out << "c2ffi-shard 2\n" << s.path << "\n" << s.nested.size() << "\n";
+        for(IncludeVector::iterator j = s.nested.begin(); j != s.nested.end(); ++j) out << *j << "\n";
+
+        out << s.entries.size() << "\n";
+        for(std::vector<ShardEntry>::iterator e = s.entries.begin(); e != s.entries.end(); ++e) {
+            out << e->events.size() << " " << e->text.size() << " " << e->first_id << " " << e->decl << "\n";
+
+            for(std::vector<ShardEntry::Event>::iterator ev = e->events.begin(); ev != e->events.end(); ++ev)
+                out << ev->kind << " " << ev->id << " " << ev->decl << "\n";
+
+            out << e->text << "\n";
+        }
+
+        write_file_atomic(shard_path(s.key), out.str());
+    }
+}
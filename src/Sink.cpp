@@ -0,0 +1,198 @@
+/*
+    c2ffi
+    Copyright (C) 2013  Ryan Pavlik
+
+    This file is part of c2ffi.
+
+    c2ffi is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    c2ffi is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with c2ffi.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <cstring>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "c2ffi/sink.h"
+
+using namespace c2ffi;
+
+FdSink::FdSink(int fd, bool owned, bool async)
+    : _fd(fd), _owned(owned), _async(async), _error(false), _cur(0), _pending(NULL), _pending_size(0), _stop(false)
+{
+    _bufs[0].resize(BUFFER_SIZE);
+
+    if(_async) {
+        _bufs[1].resize(BUFFER_SIZE);
+        _writer = std::thread(&FdSink::run, this);
+    }
+
+    setp(_bufs[0].data(), _bufs[0].data() + _bufs[0].size());
+}
+
+FdSink::~FdSink()
+{
+    close();
+}
+
+bool FdSink::write_all(const char* p, size_t n)
+{
+    while(n > 0) {
+        ssize_t r = ::write(_fd, p, n);
+        if(r < 0) {
+            if(errno == EINTR) continue;
+            return false;
+        }
+        p += r;
+        n -= r;
+    }
+
+    return true;
+}
+
+void FdSink::run()
+{
+    std::unique_lock<std::mutex> guard(_lock);
+
+    for(;;) {
+        _cond.wait(guard, [this] { return _pending || _stop; });
+        if(!_pending) return;
+
+        const char* p = _pending;
+        size_t      n = _pending_size;
+
+        guard.unlock();
+        bool ok = write_all(p, n);
+        guard.lock();
+
+        if(!ok) _error = true;
+        _pending = NULL;
+        _cond.notify_all();
+    }
+}
+
+// Until the thread has written the buffer it was given
+bool FdSink::wait()
+{
+    if(!_async) return !_error;
+
+    std::unique_lock<std::mutex> guard(_lock);
+    _cond.wait(guard, [this] { return !_pending; });
+    return !_error;
+}
+
+// Pass on what's been put so far, leaving an empty buffer to fill
+bool FdSink::drain()
+{
+    size_t n = pptr() - pbase();
+
+    if(n == 0) return wait();
+
+    if(!_async) {
+        if(!write_all(pbase(), n)) _error = true;
+        setp(pbase(), epptr());
+        return !_error;
+    }
+
+    if(!wait()) return false;
+
+    {
+        std::lock_guard<std::mutex> guard(_lock);
+        _pending      = pbase();
+        _pending_size = n;
+    }
+    _cond.notify_all();
+
+    _cur ^= 1;
+    setp(_bufs[_cur].data(), _bufs[_cur].data() + _bufs[_cur].size());
+    return true;
+}
+
+FdSink::int_type FdSink::overflow(int_type c)
+{
+    if(pptr() == epptr() && !drain()) return traits_type::eof();
+
+    if(!traits_type::eq_int_type(c, traits_type::eof())) {
+        *pptr() = traits_type::to_char_type(c);
+        pbump(1);
+    }
+
+    return traits_type::not_eof(c);
+}
+
+std::streamsize FdSink::xsputn(const char* s, std::streamsize n)
+{
+    std::streamsize done = 0;
+
+    while(done < n) {
+        if(pptr() == epptr() && !drain()) break;
+
+        std::streamsize room = std::min<std::streamsize>(epptr() - pptr(), n - done);
+        memcpy(pptr(), s + done, room);
+        pbump(room);
+        done += room;
+    }
+
+    return done;
+}
+
+// Only returns once everything put so far has been written
+int FdSink::sync()
+{
+    return drain() && wait() ? 0 : -1;
+}
+
+bool FdSink::close()
+{
+    if(_fd < 0) return !_error;
+
+    bool ok = sync() == 0;
+
+    if(_async) {
+        {
+            std::lock_guard<std::mutex> guard(_lock);
+            _stop = true;
+        }
+        _cond.notify_all();
+        _writer.join();
+    }
+
+    if(_owned && ::close(_fd) < 0) ok = false;
+    _fd = -1;
+
+    return ok;
+}
+
+// The base is given the sink once it exists
+FdStream::FdStream(int fd, bool owned, bool async) : std::ostream(NULL), _sink(fd, owned, async)
+{
+    rdbuf(&_sink);
+}
+
+FdStream* FdStream::open(const std::string& path, bool async)
+{
+    int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+    if(fd < 0) return NULL;
+
+    return new FdStream(fd, true, async);
+}
+
+bool FdStream::close()
+{
+    if(_sink.close()) return true;
+
+    setstate(std::ios::badbit);
+    return false;
+}
@@ -0,0 +1,256 @@
+/*
+    c2ffi
+    Copyright (C) 2013  Ryan Pavlik
+
+    This file is part of c2ffi.
+
+    c2ffi is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    c2ffi is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with c2ffi.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <string>
+
+#include <sys/resource.h>
+#include <time.h>
+
+#include "c2ffi/stats.h"
+
+using namespace c2ffi;
+
+static const char* phase_names[Stats::NPHASES] = {"init", "preprocess", "parse", "convert", "write", "macros"};
+
+thread_local StatsTimer* StatsTimer::_current = NULL;
+
+Stats::Time Stats::now()
+{
+    Time            t;
+    struct timespec ts;
+
+    t.wall = std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+
+    // Per thread, so --batch workers don't count each other
+    if(clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) == 0) t.cpu = ts.tv_sec + ts.tv_nsec / 1e9;
+
+    return t;
+}
+
+Stats::CountingBuf::int_type Stats::CountingBuf::overflow(int_type c)
+{
+    if(traits_type::eq_int_type(c, traits_type::eof())) return traits_type::not_eof(c);
+
+    ++_count;
+    return _buf->sputc(traits_type::to_char_type(c));
+}
+
+std::streamsize Stats::CountingBuf::xsputn(const char* s, std::streamsize n)
+{
+    std::streamsize written = _buf->sputn(s, n);
+    _count += written;
+    return written;
+}
+
+int Stats::CountingBuf::sync()
+{
+    return _buf->pubsync();
+}
+
+// Output is counted from here on; this has to come before anything
+// else diverts the streams (the cache), so it sees what they pass on.
+Stats::Stats(config& c) : _config(c), _start(now()), _output_bytes(0)
+{
+    _streams[0] = c.output;
+    _streams[1] = c.macro_output;
+    _streams[2] = c.template_output;
+
+    for(int i = 0; i < NSTREAMS; i++) {
+        _bufs[i] = NULL;
+        if(!_streams[i]) continue;
+
+        _bufs[i]  = new CountingBuf(_streams[i]->rdbuf(), _output_bytes);
+        _saved[i] = _streams[i]->rdbuf(_bufs[i]);
+    }
+
+    c.stats = this;
+}
+
+Stats::~Stats()
+{
+    Time end = now(), total;
+    total.wall = end.wall - _start.wall;
+    total.cpu  = end.cpu - _start.cpu;
+
+    for(int i = 0; i < NSTREAMS; i++) {
+        if(!_bufs[i]) continue;
+
+        _streams[i]->rdbuf(_saved[i]);
+        delete _bufs[i];
+    }
+
+    _config.stats = NULL;
+
+    // Linux reports kilobytes
+    struct rusage ru;
+    long          rss = getrusage(RUSAGE_SELF, &ru) == 0 ? ru.ru_maxrss : 0;
+
+    // One report at a time, whole, however many --batch workers finish
+    static std::mutex           lock;
+    std::lock_guard<std::mutex> guard(lock);
+    std::ostringstream          ss;
+
+    if(_config.stats_format == "json")
+        print_json(ss, total, rss);
+    else
+        print_text(ss, total, rss);
+
+    std::cerr << ss.str() << std::flush;
+}
+
+typedef std::map<std::string, unsigned long> SortedCounts;
+
+static SortedCounts sorted(const llvm::StringMap<unsigned long>& counts)
+{
+    SortedCounts m;
+
+    for(llvm::StringMap<unsigned long>::const_iterator i = counts.begin(); i != counts.end(); ++i)
+        m[i->getKey().str()] = i->getValue();
+
+    return m;
+}
+
+void Stats::print_text(std::ostream& os, const Time& total, long rss) const
+{
+    os << "c2ffi stats: " << _config.filename << "\n";
+    os << std::fixed << std::setprecision(6);
+    os << "  " << std::left << std::setw(12) << "phase" << std::right << std::setw(12) << "wall (s)"
+       << std::setw(12) << "cpu (s)"
+       << "\n";
+
+    for(int i = 0; i < NPHASES; i++)
+        os << "  " << std::left << std::setw(12) << phase_names[i] << std::right << std::setw(12) << phases[i].wall
+           << std::setw(12) << phases[i].cpu << "\n";
+
+    os << "  " << std::left << std::setw(12) << "total" << std::right << std::setw(12) << total.wall << std::setw(12)
+       << total.cpu << "\n";
+
+    os << "  peak RSS:     " << rss << " KiB\n";
+    os << "  AST memory:   " << ast_bytes << " bytes\n";
+    os << "  output:       " << _output_bytes << " bytes\n";
+    os << "  type cache:   " << _type_hits << " of " << _type_lookups << " hit";
+
+    if(_type_lookups) os << std::setprecision(1) << " (" << 100.0 * _type_hits / _type_lookups << "%)";
+
+    os << "\n";
+
+    SortedCounts decls = sorted(_decls), types = sorted(_types);
+
+    os << "  decls:\n";
+    for(SortedCounts::const_iterator i = decls.begin(); i != decls.end(); ++i)
+        os << "    " << std::left << std::setw(24) << i->first << std::right << i->second << "\n";
+
+    os << "  types:\n";
+    for(SortedCounts::const_iterator i = types.begin(); i != types.end(); ++i)
+        os << "    " << std::left << std::setw(24) << i->first << std::right << i->second << "\n";
+}
+
+static std::string json_string(const std::string& s)
+{
+    std::string out = "\"";
+
+    for(std::string::const_iterator i = s.begin(); i != s.end(); ++i) {
+        unsigned char c = *i;
+
+        if(c == '"' || c == '\\') {
+            out += '\\';
+            out += c;
+        } else if(c < 0x20) {
+            char buf[8];
+            snprintf(buf, sizeof(buf), "\\u%04x", c);
+            out += buf;
+        } else {
+            out += c;
+        }
+    }
+
+    return out + "\"";
+}
+
+static void print_json_counts(std::ostream& os, const SortedCounts& counts)
+{
+    os << "{";
+    for(SortedCounts::const_iterator i = counts.begin(); i != counts.end(); ++i)
+        os << (i == counts.begin() ? "" : ", ") << json_string(i->first) << ": " << i->second;
+    os << "}";
+}
+
+// One object per line, so runs over many files can be collected by
+// appending
+void Stats::print_json(std::ostream& os, const Time& total, long rss) const
+{
+    os << std::fixed << std::setprecision(6);
+    os << "{\"file\": " << json_string(_config.filename) << ", \"phases\": {";
+
+    for(int i = 0; i < NPHASES; i++)
+        os << (i ? ", " : "") << "\"" << phase_names[i] << "\": {\"wall\": " << phases[i].wall
+           << ", \"cpu\": " << phases[i].cpu << "}";
+
+    os << "}, \"total\": {\"wall\": " << total.wall << ", \"cpu\": " << total.cpu << "}";
+    os << ", \"peak_rss_kib\": " << rss;
+    os << ", \"ast_bytes\": " << ast_bytes;
+    os << ", \"output_bytes\": " << _output_bytes;
+    os << ", \"type_cache\": {\"lookups\": " << _type_lookups << ", \"hits\": " << _type_hits << "}";
+
+    os << ", \"decls\": ";
+    print_json_counts(os, sorted(_decls));
+    os << ", \"types\": ";
+    print_json_counts(os, sorted(_types));
+    os << "}\n";
+}
+
+StatsTimer::StatsTimer(Stats* stats, Stats::Phase phase) : _stats(stats), _phase(phase), _outer(NULL)
+{
+    if(!_stats) return;
+
+    _start = Stats::now();
+    _outer = _current;
+    if(_outer) _outer->charge(_start);
+    _current = this;
+}
+
+void StatsTimer::stop()
+{
+    if(!_stats) return;
+
+    Stats::Time end = Stats::now();
+    charge(end);
+
+    _current = _outer;
+    if(_outer) _outer->_start = end;
+
+    _stats = NULL;
+}
+
+void StatsTimer::charge(const Stats::Time& now)
+{
+    Stats::Time& t = _stats->phases[_phase];
+
+    t.wall += now.wall - _start.wall;
+    t.cpu += now.cpu - _start.cpu;
+    _start = now;
+}
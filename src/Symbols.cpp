@@ -0,0 +1,292 @@
+/*
+    c2ffi
+    Copyright (C) 2013  Ryan Pavlik
+
+    This file is part of c2ffi.
+
+    c2ffi is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    c2ffi is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with c2ffi.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <fstream>
+#include <string>
+
+#include <sys/stat.h>
+
+#include <clang/AST/Decl.h>
+#include <clang/AST/DeclCXX.h>
+#include <clang/AST/DeclObjC.h>
+#include <clang/AST/Type.h>
+
+#include "c2ffi/ast.h"
+#include "c2ffi/symbols.h"
+
+using namespace c2ffi;
+
+bool c2ffi::add_symbol_patterns(IncludeVector& patterns, const std::string& arg, std::string& error)
+{
+    IncludeVector added;
+    struct stat   buf;
+
+    if(stat(arg.c_str(), &buf) == 0 && S_ISREG(buf.st_mode)) {
+        std::ifstream in(arg);
+        std::string   line;
+
+        while(std::getline(in, line)) {
+            std::string::size_type end = line.find_last_not_of(" \t\r");
+            if(end == std::string::npos || line[0] == '#') continue;
+
+            added.push_back(line.substr(0, end + 1));
+        }
+    } else {
+        added.push_back(arg);
+    }
+
+    for(IncludeVector::const_iterator i = added.begin(); i != added.end(); ++i) {
+        llvm::Regex re(*i);
+
+        if(!re.isValid(error)) {
+            error = *i + ": " + error;
+            return false;
+        }
+    }
+
+    patterns.insert(patterns.end(), added.begin(), added.end());
+    return true;
+}
+
+SymbolSet::SymbolSet(const config& c)
+{
+    for(IncludeVector::const_iterator i = c.symbols.begin(); i != c.symbols.end(); ++i)
+        _patterns.push_back(std::unique_ptr<llvm::Regex>(new llvm::Regex(*i)));
+}
+
+bool SymbolSet::matches(llvm::StringRef name) const
+{
+    for(size_t i = 0; i < _patterns.size(); i++)
+        if(_patterns[i]->match(name)) return true;
+
+    return false;
+}
+
+void SymbolSet::add(clang::Decl* d, bool forced)
+{
+    _decls.push_back(d);
+    if(forced) _forced.insert(d);
+}
+
+void SymbolSet::close()
+{
+    for(std::vector<clang::Decl*>::const_iterator i = _decls.begin(); i != _decls.end(); ++i) {
+        if(_forced.count(*i))
+            mark(*i);
+        else
+            find_roots(*i);
+    }
+
+    while(!_work.empty()) {
+        const clang::Decl* d = _work.back();
+        _work.pop_back();
+        walk(d);
+    }
+}
+
+bool SymbolSet::wanted(const clang::Decl* d) const
+{
+    return _wanted.count(d->getCanonicalDecl()) || _contexts.count(d);
+}
+
+// Roots can be in namespaces and extern "C" blocks, but not records;
+// c2ffi doesn't output their members separately.
+void SymbolSet::find_roots(const clang::Decl* d)
+{
+    if_const_cast(nd, clang::NamedDecl, d)
+    {
+        if(!llvm::isa<clang::NamespaceDecl>(nd) && nd->getIdentifier()
+           && (matches(nd->getName()) || matches(nd->getQualifiedNameAsString())))
+            mark(nd);
+    }
+
+    if(llvm::isa<clang::NamespaceDecl>(d) || llvm::isa<clang::LinkageSpecDecl>(d)) {
+        const clang::DeclContext* dc = llvm::cast<clang::DeclContext>(d);
+
+        for(clang::DeclContext::decl_iterator i = dc->decls_begin(); i != dc->decls_end(); ++i) find_roots(*i);
+    }
+}
+
+void SymbolSet::mark(const clang::Decl* d)
+{
+    if(!d) return;
+
+    const clang::Decl* c = d->getCanonicalDecl();
+    if(!_wanted.insert(c).second) return;
+
+    _work.push_back(c);
+
+    for(const clang::Decl* r : c->redecls()) mark_contexts(r);
+}
+
+// A decl is only reached through what contains it, so that has to be
+// output too: all of a record, but only this instance of a namespace.
+void SymbolSet::mark_contexts(const clang::Decl* d)
+{
+    for(const clang::DeclContext* dc = d->getDeclContext(); dc && !dc->isTranslationUnit(); dc = dc->getParent()) {
+        const clang::Decl* p = clang::Decl::castFromDeclContext(dc);
+
+        if(llvm::isa<clang::TagDecl>(p) || llvm::isa<clang::ObjCContainerDecl>(p))
+            mark(p);
+        else
+            _contexts.insert(p);
+    }
+}
+
+void SymbolSet::walk(const clang::Decl* d)
+{
+    if_const_cast(f, clang::FunctionDecl, d)
+    {
+        walk_type(f->getReturnType());
+
+        for(clang::FunctionDecl::param_const_iterator i = f->param_begin(); i != f->param_end(); ++i)
+            walk_type((*i)->getType());
+    }
+    else if_const_cast(v, clang::VarDecl, d) walk_type(v->getType());
+    else if_const_cast(td, clang::TypedefNameDecl, d) walk_type(td->getUnderlyingType());
+    else if_const_cast(tag, clang::TagDecl, d)
+    {
+        const clang::TagDecl* def = tag->getDefinition();
+        if(!def) return;
+
+        if_const_cast(r, clang::RecordDecl, def)
+        {
+            for(clang::RecordDecl::field_iterator i = r->field_begin(); i != r->field_end(); ++i)
+                walk_type(i->getType());
+        }
+
+        if_const_cast(cxx, clang::CXXRecordDecl, def)
+        {
+            for(clang::CXXRecordDecl::base_class_const_iterator i = cxx->bases_begin(); i != cxx->bases_end(); ++i)
+                walk_type(i->getType());
+        }
+
+        // Nested definitions are output with their parent
+        for(clang::DeclContext::decl_iterator i = def->decls_begin(); i != def->decls_end(); ++i)
+            if(llvm::isa<clang::TagDecl>(*i)) mark(*i);
+    }
+    else if_const_cast(i, clang::ObjCInterfaceDecl, d)
+    {
+        const clang::ObjCInterfaceDecl* def = i->getDefinition();
+        if(!def) return;
+
+        mark(def->getSuperClass());
+
+        for(clang::ObjCInterfaceDecl::protocol_iterator p = def->protocol_begin(); p != def->protocol_end(); ++p)
+            mark(*p);
+
+        for(clang::ObjCInterfaceDecl::ivar_iterator iv = def->ivar_begin(); iv != def->ivar_end(); ++iv)
+            walk_type(iv->getType());
+
+        for(const clang::ObjCCategoryDecl* cat : def->visible_categories()) mark(cat);
+
+        walk_container(def);
+    }
+    else if_const_cast(p, clang::ObjCProtocolDecl, d)
+    {
+        const clang::ObjCProtocolDecl* def = p->getDefinition();
+        if(!def) return;
+
+        for(clang::ObjCProtocolDecl::protocol_iterator i = def->protocol_begin(); i != def->protocol_end(); ++i)
+            mark(*i);
+
+        walk_container(def);
+    }
+    else if_const_cast(cat, clang::ObjCCategoryDecl, d)
+    {
+        mark(cat->getClassInterface());
+
+        for(clang::ObjCCategoryDecl::protocol_iterator i = cat->protocol_begin(); i != cat->protocol_end(); ++i)
+            mark(*i);
+
+        walk_container(cat);
+    }
+}
+
+void SymbolSet::walk_container(const clang::ObjCContainerDecl* c)
+{
+    for(const clang::ObjCMethodDecl* m : c->methods()) {
+        walk_type(m->getReturnType());
+
+        for(const clang::ParmVarDecl* p : m->parameters()) walk_type(p->getType());
+    }
+
+    for(const clang::ObjCPropertyDecl* p : c->properties()) walk_type(p->getType());
+}
+
+// Follow t to the decls it names, through the same kinds of type
+// Type::make_type() converts
+void SymbolSet::walk_type(clang::QualType qt)
+{
+    const clang::Type* t = qt.getTypePtrOrNull();
+
+    while(t) {
+        if_const_cast(td, clang::TypedefType, t)
+        {
+            mark(td->getDecl());
+            return;
+        }
+
+        if_const_cast(tt, clang::TagType, t)
+        {
+            mark(tt->getDecl());
+            return;
+        }
+
+        if_const_cast(ot, clang::ObjCObjectType, t)
+        {
+            mark(ot->getInterface());
+            for(clang::ObjCProtocolDecl* p : ot->quals()) mark(p);
+            return;
+        }
+
+        if_const_cast(ft, clang::FunctionProtoType, t)
+        {
+            for(clang::QualType p : ft->param_types()) walk_type(p);
+        }
+
+        if_const_cast(ft, clang::FunctionType, t)
+        {
+            t = ft->getReturnType().getTypePtrOrNull();
+            continue;
+        }
+
+        if_const_cast(ts, clang::TemplateSpecializationType, t)
+        {
+            if(!ts->isTypeAlias()) {
+                mark(t->getAsCXXRecordDecl());
+                return;
+            }
+        }
+
+        if_const_cast(mp, clang::MemberPointerType, t) walk_type(clang::QualType(mp->getClass(), 0));
+
+        if(t->isAnyPointerType() || t->isReferenceType() || t->isBlockPointerType() || t->isMemberPointerType())
+            t = t->getPointeeType().getTypePtrOrNull();
+        else if_const_cast(at, clang::ArrayType, t) t = at->getElementType().getTypePtrOrNull();
+        else if_const_cast(vt, clang::VectorType, t) t = vt->getElementType().getTypePtrOrNull();
+        else if_const_cast(ct, clang::ComplexType, t) t = ct->getElementType().getTypePtrOrNull();
+        else if_const_cast(atom, clang::AtomicType, t) t = atom->getValueType().getTypePtrOrNull();
+        else if(t->isSugared())
+            t = t->getLocallyUnqualifiedSingleStepDesugaredType().getTypePtrOrNull();
+        else
+            return;
+    }
+}
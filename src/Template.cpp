@@ -64,7 +64,7 @@ TemplateArg::TemplateArg(C2FFIASTConsumer* ast, const clang::TemplateArgument& a
     } else {
         std::stringstream ss;
         ss << "<unknown:" << arg.getKind() << ">";
-        _type = new SimpleType(ast->ci(), NULL, ss.str());
+        _type = ast->arena().make<SimpleType>(ast->ci(), (const clang::Type*)NULL, ss.str());
     }
 }
 
@@ -76,7 +76,7 @@ TemplateMixin::TemplateMixin(C2FFIASTConsumer* ast, const clang::TemplateArgumen
 
     _is_template = true;
 
-    for(size_t i = 0; i < arglist->size(); i++) _args.push_back(new TemplateArg(ast, (*arglist)[i]));
+    for(size_t i = 0; i < arglist->size(); i++) _args.push_back(ast->arena().make<TemplateArg>(ast, (*arglist)[i]));
 }
 
 void C2FFIASTConsumer::write_template(
@@ -124,5 +124,5 @@ void C2FFIASTConsumer::write_template(
         }
     }
 
-    out << ">;" << endl;
+    out << ">;\n";
 }
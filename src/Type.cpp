@@ -25,13 +25,15 @@
 #include <clang/AST/DeclObjC.h>
 #include <clang/AST/DeclTemplate.h>
 #include <clang/AST/ASTContext.h>
+#include <llvm/Support/TimeProfiler.h>
 #include "c2ffi.h"
 #include "c2ffi/ast.h"
+#include "c2ffi/stats.h"
 
 using namespace c2ffi;
 
 Type::Type(const clang::CompilerInstance &ci, const clang::Type *t)
-    : _id(0), _ci(ci), _type(t), _bit_offset(0), _bit_size(0), _bit_alignment(0) { }
+    : _id(0), _ci(ci), _type(t), _bit_size(0), _bit_alignment(0) { }
 
 std::string Type::metatype() const {
     if(_type)
@@ -80,8 +82,69 @@ static std::string make_builtin_name(const clang::BuiltinType *bt) {
     return name;
 }
 
+// Sugar that converts to just the type it names
+static const clang::Type* named_type(const clang::Type *t) {
+    if_const_cast(e, clang::ElaboratedType, t)
+        return e->getNamedType().getTypePtr();
+
+    if_const_cast(tt, clang::SubstTemplateTypeParmType, t)
+        return tt->desugar().getTypePtr();
+
+    if_const_cast(tt, clang::TemplateSpecializationType, t)
+        return tt->desugar().getTypePtr();
+
+    return t;
+}
+
+// Where a new type goes: one make_type() may share lives as long as
+// the cache, anything else only until its decl is written
+static Arena& arena_for(C2FFIASTConsumer *ast, bool shareable) {
+    return shareable ? ast->type_arena() : ast->arena();
+}
+
+static Type* build_type(C2FFIASTConsumer *ast, const clang::Type *t) {
+    if(TypeTable *table = ast->type_table())
+        return table->intern(ast, t);
+
+    return Type::convert(ast, t);
+}
+
 Type* Type::make_type(C2FFIASTConsumer *ast, const clang::Type *t) {
+    TypeCache &cache = ast->type_cache();
+
+    if(Type *type = cache.find(t)) {
+        if(ast->stats()) ast->stats()->count_type_lookup(true);
+        return type;
+    }
+
+    if(ast->stats()) ast->stats()->count_type_lookup(false);
+
+    Type *type = build_type(ast, t);
+    cache.add(t, type);
+
+    return type;
+}
+
+Type* Type::make_field_type(C2FFIASTConsumer *ast, const clang::Type *t,
+                            unsigned width) {
+    Type *type = make_type(ast, t);
+
+    // Not kept in the cache, so one per field
+    if(width)
+        type = ast->arena().make<BitfieldType>(ast->ci(), t, width, type);
+
+    return type;
+}
+
+// Convert t, with make_type() for the types it's made of.  Types that
+// can't be shared, and those made from them, go in the decl arena.
+Type* Type::convert(C2FFIASTConsumer *ast, const clang::Type *t) {
     clang::CompilerInstance &ci = ast->ci();
+    Arena &arena = ast->type_arena();
+
+    llvm::TimeTraceScope trace("make_type", [&] { return std::string(t->getTypeClassName()); });
+
+    if(ast->stats()) ast->stats()->count_type(t->getTypeClassName());
 
     /*
     std::cout << "type: " << t->getTypeClassName() << std::endl
@@ -92,60 +155,55 @@ Type* Type::make_type(C2FFIASTConsumer *ast, const clang::Type *t) {
     /*** Order is important here ***/
 
     if(t->isVoidType())
-        return new SimpleType(ci, t, ":void");
+        return arena.make<SimpleType>(ci, t, ":void");
 
     if_const_cast(td, clang::TypedefType, t) {
         const clang::TypedefNameDecl *tdd = td->getDecl();
-        return new SimpleType(ci, td, tdd->getDeclName().getAsString());
+        return arena.make<SimpleType>(ci, td, tdd->getDeclName().getAsString());
     }
 
-    if_const_cast(e, clang::ElaboratedType, t) {
-        return make_type(ast, e->getNamedType().getTypePtr());
-    }
-
-    if_const_cast(tt, clang::SubstTemplateTypeParmType, t) {
-        if(tt != tt->desugar().getTypePtr())
-            return make_type(ast, tt->desugar().getTypePtr());
-    }
+    if(named_type(t) != t)
+        return make_type(ast, named_type(t));
 
     if(t->isBuiltinType()) {
         const clang::BuiltinType *bt = llvm::dyn_cast<clang::BuiltinType>(t);
-        if(!bt) return new SimpleType(ci, t, std::string("<unknown-builtin-type:") +
-                                      t->getTypeClassName() + ">");
+        if(!bt) return arena.make<SimpleType>(ci, t, std::string("<unknown-builtin-type:") +
+                                              t->getTypeClassName() + ">");
 
-        return new BasicType(ci, t, make_builtin_name(bt));
+        return arena.make<BasicType>(ci, t, make_builtin_name(bt));
     }
 
-    if_const_cast(e, clang::ElaboratedType, t)
-        return make_type(ast, e->getNamedType().getTypePtr());
-
     if(t->isFunctionPointerType())
-        return new SimpleType(ci, t, ":function-pointer");
+        return arena.make<SimpleType>(ci, t, ":function-pointer");
 
     if(t->isFunctionType())
-        return new SimpleType(ci, t, ":function");
+        return arena.make<SimpleType>(ci, t, ":function");
 
-    if(t->isPointerType())
-        return new PointerType(ci, t, make_type(ast, t->getPointeeType().getTypePtr()));
+    if(t->isPointerType()) {
+        Type *pointee = make_type(ast, t->getPointeeType().getTypePtr());
+        return arena_for(ast, pointee->shareable()).make<PointerType>(ci, t, pointee);
+    }
 
-    if(t->isReferenceType())
-        return new ReferenceType(ci, t, make_type(ast, t->getPointeeType().getTypePtr()));
+    if(t->isReferenceType()) {
+        Type *pointee = make_type(ast, t->getPointeeType().getTypePtr());
+        return arena_for(ast, pointee->shareable()).make<ReferenceType>(ci, t, pointee);
+    }
 
     if_const_cast(rt, clang::RecordType, t) {
         clang::RecordDecl *rd = rt->getDecl();
 
         if(rd->isInvalidDecl())
-            return new SimpleType(ci, t, std::string("<invalid-type:") +
-                                  t->getTypeClassName() + ">");
+            return arena.make<SimpleType>(ci, t, std::string("<invalid-type:") +
+                                          t->getTypeClassName() + ">");
 
         ast->add_cxx_decl(rd);
 
         if((rd->isThisDeclarationADefinition() && rd->isEmbeddedInDeclarator() && !ast->is_cur_decl(rd)) ||
            (rd != rd->getDefinition())) {
-            return new DeclType(ci, t, ast->make_decl(rd, false), rd);
+            return ast->arena().make<DeclType>(ci, t, ast->make_decl(rd, false), rd);
         } else {
             std::string name = rd->getDeclName().getAsString();
-            RecordType *rec = new RecordType(ast, t, name, rd->isUnion(), rd->isClass());
+            RecordType *rec = arena.make<RecordType>(ast, t, name, rd->isUnion(), rd->isClass());
 
             rec->set_id(ast->decl_id(rd));
 
@@ -153,51 +211,49 @@ Type* Type::make_type(C2FFIASTConsumer *ast, const clang::Type *t) {
         }
     }
 
-    if_const_cast(tt, clang::TemplateSpecializationType, t) {
-        if(tt != tt->desugar().getTypePtr())
-            return make_type(ast, tt->desugar().getTypePtr());
-    }
-
     if_const_cast(ed, clang::EnumType, t) {
         std::string name = ed->getDecl()->getDeclName().getAsString();
 
         if(ed->getDecl()->isThisDeclarationADefinition() &&
            !ast->is_cur_decl(ed->getDecl()))
-            return new DeclType(ci, t, ast->make_decl(ed->getDecl(), false),
-                                ed->getDecl());
+            return ast->arena().make<DeclType>(ci, t, ast->make_decl(ed->getDecl(), false),
+                                               ed->getDecl());
         else {
-            EnumType *et = new EnumType(ci, t, name);
-
-            if(name == "")
-                et->set_id(ast->decl_id(ed->getDecl()));
+            unsigned int id = name == "" ? ast->decl_id(ed->getDecl()) : 0;
+            EnumType *et = arena_for(ast, name != "" || id).make<EnumType>(ci, t, name);
 
+            et->set_id(id);
             return et;
         }
     }
 
-    if_const_cast(ca, clang::ConstantArrayType, t)
-        return new ArrayType(ci, ca,
-                             make_type(ast, ca->getElementType().getTypePtr()),
-                             ca->getSize().getLimitedValue());
+    if_const_cast(ca, clang::ConstantArrayType, t) {
+        Type *element = make_type(ast, ca->getElementType().getTypePtr());
+        return arena_for(ast, element->shareable()).make<ArrayType>(ci, ca, element,
+                                                                    ca->getSize().getLimitedValue());
+    }
 
-    if_const_cast(ca, clang::IncompleteArrayType, t)
-        return new PointerType(ci, ca,
-                               make_type(ast, ca->getElementType().getTypePtr()));
+    if_const_cast(ca, clang::IncompleteArrayType, t) {
+        Type *element = make_type(ast, ca->getElementType().getTypePtr());
+        return arena_for(ast, element->shareable()).make<PointerType>(ci, ca, element);
+    }
 
-    if_const_cast(op, clang::ObjCObjectPointerType, t)
-        return new PointerType(ci, op,
-                               make_type(ast, op->getPointeeType().getTypePtr()));
+    if_const_cast(op, clang::ObjCObjectPointerType, t) {
+        Type *pointee = make_type(ast, op->getPointeeType().getTypePtr());
+        return arena_for(ast, pointee->shareable()).make<PointerType>(ci, op, pointee);
+    }
 
     if_const_cast(ob, clang::ObjCObjectType, t)
-        return new SimpleType(ci, t, ob->getInterface()->getDeclName().getAsString());
+        return arena.make<SimpleType>(ci, t, ob->getInterface()->getDeclName().getAsString());
 
-    if_const_cast(cx, clang::ComplexType, t)
-        return new ComplexType(ci, cx,
-                               make_type(ast, cx->getElementType().getTypePtr()));
+    if_const_cast(cx, clang::ComplexType, t) {
+        Type *element = make_type(ast, cx->getElementType().getTypePtr());
+        return arena_for(ast, element->shareable()).make<ComplexType>(ci, cx, element);
+    }
 
  error:
-    return new SimpleType(ci, t, std::string("<unknown-type:") +
-                          t->getTypeClassName() + ">");
+    return arena.make<SimpleType>(ci, t, std::string("<unknown-type:") +
+                                  t->getTypeClassName() + ">");
 }
 
 bool PointerType::is_string() const {
@@ -225,3 +281,49 @@ void DeclType::write(OutputDriver &od) const {
     if(_d)
         _d->write(od);
 }
+
+Type* TypeTable::intern(C2FFIASTConsumer *ast, const clang::Type *t) {
+    TypeIDMap::const_iterator it = _ids.find(t);
+
+    if(it != _ids.end())
+        return ast->type_arena().make<TypeRef>(ast->ci(), t, it->second);
+
+    Type *type = Type::convert(ast, t);
+
+    // Sugar like an elaborated type converts to just what it names, so
+    // this can share that entry instead of wrapping it in another
+    if(type->is_ref()) {
+        _ids.insert(TypeIDMap::value_type(t, type->id()));
+        return ast->type_arena().make<TypeRef>(ast->ci(), t, type->id());
+    }
+
+    // A record defined inline may have reached itself through its
+    // fields, which keeps the first id
+    unsigned int id = ++_last_id;
+    _ids.insert(TypeIDMap::value_type(t, id));
+    _pending.push_back(ast->type_arena().make<TypeEntry>(id, type));
+
+    return ast->type_arena().make<TypeRef>(ast->ci(), t, id);
+}
+
+void TypeTable::write_pending(OutputDriver &od, bool &mid) {
+    for(size_t i = 0; i < _pending.size(); i++) {
+        if(mid)
+            od.write_between();
+        else
+            mid = true;
+
+        od.write(*_pending[i]);
+    }
+
+    _pending.clear();
+}
+
+Type* TypeCache::find(const clang::Type *t) const {
+    TypeMap::const_iterator it = _types.find(t);
+    return it == _types.end() ? NULL : it->second;
+}
+
+void TypeCache::add(const clang::Type *t, Type *type) {
+    if(type->shareable()) _types[t] = type;
+}
@@ -20,88 +20,54 @@
 
 #include <iostream>
 
-#include <llvm/Support/raw_os_ostream.h>
-#include <llvm/TargetParser/Host.h>
-#include <llvm/ADT/IntrusiveRefCntPtr.h>
-
-#include <clang/Basic/Version.h>
-#include <clang/Basic/DiagnosticOptions.h>
-#include <clang/Frontend/TextDiagnosticPrinter.h>
-#include <clang/Frontend/CompilerInstance.h>
-#include <clang/Frontend/Utils.h>
-#include <clang/Basic/TargetOptions.h>
-#include <clang/Basic/TargetInfo.h>
-#include <clang/Basic/FileManager.h>
-#include <clang/Basic/SourceManager.h>
-#include <clang/Lex/HeaderSearch.h>
-#include <clang/Lex/Preprocessor.h>
-#include <clang/Basic/Diagnostic.h>
-#include <clang/AST/ASTContext.h>
-#include <clang/AST/ASTConsumer.h>
-#include <clang/Parse/Parser.h>
-#include <clang/Parse/ParseAST.h>
+#include <llvm/Support/Error.h>
+#include <llvm/Support/TimeProfiler.h>
 
 #include "c2ffi.h"
-#include "c2ffi/init.h"
 #include "c2ffi/opt.h"
-#include "c2ffi/ast.h"
-#include "c2ffi/macros.h"
+#include "c2ffi/process.h"
+#include "c2ffi/sink.h"
 
 using namespace c2ffi;
 
 int main(int argc, char *argv[]) {
-    clang::CompilerInstance ci;
     c2ffi::config sys;
+    int result;
 
     process_args(sys, argc, argv);
-    // this finishes parsing the arguments using clang
-    init_ci(sys, ci);
-
-    add_includes(ci, sys.includes, false, true);
-    add_includes(ci, sys.sys_includes, true, true);
-
-    C2FFIASTConsumer *astc = NULL;
-
-    const clang::FileEntry *file = ci.getFileManager().getFile(sys.filename).get();
-    clang::FileID fid = ci.getSourceManager().createFileID(file,
-                                                           clang::SourceLocation(),
-                                                           clang::SrcMgr::C_User);
-    ci.getSourceManager().setMainFileID(fid);
-    ci.getDiagnosticClient().BeginSourceFile(ci.getLangOpts(),
-                                             &ci.getPreprocessor());
-
-    if(sys.preprocess_only) {
-        llvm::raw_ostream *os = new llvm::raw_os_ostream(*sys.output);
-        clang::DoPrintPreprocessedInput(ci.getPreprocessor(), os,
-                                        ci.getPreprocessorOutputOpts());
-        delete os;
-    } else {
-        astc = new C2FFIASTConsumer(ci, sys);
-        ci.setASTConsumer(std::unique_ptr<clang::ASTConsumer>(astc));
-        ci.createASTContext();
-
-        sys.od->write_header();
-
-        if(sys.to_namespace != "")
-            sys.od->write_namespace(sys.to_namespace);
-
-        clang::ParseAST(ci.getPreprocessor(), astc, ci.getASTContext());
-        astc->PostProcess();
-        sys.od->write_footer();
-
-        if(sys.macro_output) {
-            process_macros(ci, *sys.macro_output, sys);
-            sys.macro_output->close();
-        }
 
-        if(sys.template_output)
-            sys.template_output->close();
+    if(!sys.time_trace.empty())
+        llvm::timeTraceProfilerInitialize(sys.time_trace_granularity, "c2ffi");
+
+    if(!sys.batch_file.empty())
+        result = process_batch(sys);
+    else if(!sys.serve_socket.empty())
+        result = process_serve(sys);
+    else
+        result = process_file(sys);
+
+    // Closing the outputs writes whatever is still buffered
+    if(sys.od && !sys.od->close())
+        result = 1;
+    delete sys.od;
+
+    if(FdStream *out = dynamic_cast<FdStream*>(sys.output)) {
+        if(!out->close()) {
+            std::cerr << "Error: Could not write output" << std::endl;
+            result = 1;
+        }
     }
+    delete sys.output;
 
-    ci.getDiagnosticClient().EndSourceFile();
-    sys.output->flush();
+    if(!sys.time_trace.empty()) {
+        if(llvm::Error e = llvm::timeTraceProfilerWrite(sys.time_trace, sys.filename)) {
+            std::cerr << "Error: Could not write time trace: "
+                      << llvm::toString(std::move(e)) << std::endl;
+            result = 1;
+        }
+
+        llvm::timeTraceProfilerCleanup();
+    }
 
-    if(sys.fail_on_error && ci.getDiagnostics().hasErrorOccurred())
-        return 1;
-    return 0;
+    return result;
 }
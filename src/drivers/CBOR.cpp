@@ -0,0 +1,576 @@
+/* -*- c++ -*-
+
+   c2ffi
+   Copyright (C) 2013  Ryan Pavlik
+
+   This file is part of c2ffi.
+
+   c2ffi is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 2 of the License, or
+   (at your option) any later version.
+
+   c2ffi is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with c2ffi.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <streambuf>
+#include <type_traits>
+
+#include <llvm/ADT/StringMap.h>
+
+#include "c2ffi.h"
+
+using namespace c2ffi;
+
+/*
+   The same objects as the JSON driver, in CBOR (RFC 8949): each is a
+   map from the same keys, with "tag" first, and the decls are items
+   of one array.  Maps are indefinite-length, since some fields are
+   optional; arrays have their length.
+
+   The whole array is in a stringref namespace (tags 256 and 25, see
+   http://cbor.schmorp.de/stringref), so every key, tag and name after
+   its first use is a reference to it.  Because a reference counts
+   the strings written since the start of the output, decls can't be
+   copied between outputs, and --shard-dir is not used with this
+   driver.
+ */
+
+namespace c2ffi {
+    class CBOROutputDriver : public OutputDriver {
+        enum Major { UINT = 0, NINT = 1, TEXT = 3, ARRAY = 4, MAP = 5, TAG = 6 };
+
+        // Index of each string in the stringref table
+        llvm::StringMap<uint64_t> _strings;
+
+        void raw(const char *s, size_t n) {
+            if(os().rdbuf()->sputn(s, n) != (std::streamsize)n)
+                os().setstate(std::ios::badbit);
+        }
+
+        void byte(unsigned char c) {
+            if(std::char_traits<char>::eq_int_type(os().rdbuf()->sputc((char)c),
+                                                   std::char_traits<char>::eof()))
+                os().setstate(std::ios::badbit);
+        }
+
+        // The initial byte of an item, and its argument, big-endian
+        void head(Major major, uint64_t v) {
+            char buf[9];
+            int n;
+
+            if(v < 24) {
+                byte((major << 5) | v);
+                return;
+            } else if(v <= 0xff) {
+                buf[0] = (major << 5) | 24; n = 1;
+            } else if(v <= 0xffff) {
+                buf[0] = (major << 5) | 25; n = 2;
+            } else if(v <= 0xffffffff) {
+                buf[0] = (major << 5) | 26; n = 4;
+            } else {
+                buf[0] = (major << 5) | 27; n = 8;
+            }
+
+            for(int i = n; i > 0; i--, v >>= 8)
+                buf[i] = (char)(v & 0xff);
+
+            raw(buf, n + 1);
+        }
+
+        template<typename T> void num(T v) {
+            if constexpr(std::is_signed<T>::value) {
+                if(v < 0) {
+                    head(NINT, (uint64_t)(-(v + 1)));
+                    return;
+                }
+            }
+
+            head(UINT, (uint64_t)v);
+        }
+
+        void boolean(bool v) { byte(v ? 0xf5 : 0xf4); }
+
+        void real(double v) {
+            uint64_t bits;
+            memcpy(&bits, &v, sizeof(bits));
+
+            char buf[9];
+            buf[0] = (char)0xfb;
+            for(int i = 8; i > 0; i--, bits >>= 8)
+                buf[i] = (char)(bits & 0xff);
+
+            raw(buf, 9);
+        }
+
+        /* A text string, or a reference to the same one written before.
+           The reader adds every string at least as long as a reference
+           to it would be to its table, so this has to as well. */
+        void str(const char *s, size_t n) {
+            llvm::StringRef ref(s, n);
+            llvm::StringMap<uint64_t>::const_iterator i = _strings.find(ref);
+
+            if(i != _strings.end()) {
+                head(TAG, 25);
+                head(UINT, i->second);
+                return;
+            }
+
+            uint64_t next = _strings.size();
+            size_t   min  = next < 24 ? 3 : next < 256 ? 4 : next < 65536 ? 5 : next < 4294967296ULL ? 7 : 11;
+
+            if(n >= min) _strings[ref] = next;
+
+            head(TEXT, n);
+            raw(s, n);
+        }
+
+        void str(const char *s) { str(s, strlen(s)); }
+        void str(const std::string &s) { str(s.data(), s.size()); }
+
+        /* A constant's value: a number if it reads as one.  Integers
+           too wide for 64 bits are kept exactly, as text. */
+        void value(const std::string &v) {
+            const char *s = v.c_str();
+            char *end;
+
+            errno = 0;
+            if(s[0] == '-') {
+                long long n = strtoll(s, &end, 10);
+                if(!*end && !errno) { num(n); return; }
+            } else {
+                unsigned long long n = strtoull(s, &end, 10);
+                if(!*end && !errno) { num(n); return; }
+            }
+
+            if(!*end) { str(v); return; }
+
+            double d = strtod(s, &end);
+            if(!*end) { real(d); return; }
+
+            str(v);
+        }
+
+        // { "tag": "TAG"
+        void open(const char *tag) {
+            byte((MAP << 5) | 31);
+            str("tag");
+            str(tag);
+        }
+
+        void open(const std::string &tag) { open(tag.c_str()); }
+
+        // "NAME": and then the value
+        void key(const char *name) { str(name); }
+
+        void close() { byte(0xff); }
+
+        void array(size_t n) { head(ARRAY, n); }
+
+        void field(const char *name, const std::string &v) { key(name); str(v); }
+        void field(const char *name, const char *v) { key(name); str(v); }
+        void field(const char *name, bool v) { key(name); boolean(v); }
+        template<typename T> void field(const char *name, T v) { key(name); num(v); }
+
+        void write_fields(const NameTypeVector &fields) {
+            array(fields.size());
+            for(NameTypeVector::const_iterator i = fields.begin();
+                i != fields.end(); i++) {
+                open("field");
+                field("name", i->first);
+                field("bit-offset", i->bit_offset);
+                field("bit-size", i->bit_size);
+                field("bit-alignment", i->bit_alignment);
+                key("type");
+                write(*(i->second));
+                close();
+            }
+        }
+
+        void write_template(const TemplateMixin &d) {
+            if(d.is_template()) {
+                key("template");
+                array(d.args().size());
+                for(TemplateArgVector::const_iterator i =
+                        d.args().begin();
+                    i != d.args().end(); ++i) {
+                    open("parameter");
+                    key("type");
+                    write(*((*i)->type()));
+
+                    if((*i)->has_val())
+                        field("value", (*i)->val());
+
+                    close();
+                }
+            }
+        }
+
+        void write_functions(const FunctionVector &funcs) {
+            array(funcs.size());
+            for(FunctionVector::const_iterator i = funcs.begin();
+                i != funcs.end(); i++)
+                write((const Writable&)*(*i));
+        }
+
+        void write_function_header(const FunctionDecl &d) {
+            open("function");
+            field("name", d.name());
+            field("ns", d.ns());
+            field("location", d.location());
+            field("variadic", d.is_variadic());
+            field("inline", d.is_inline());
+            field("storage-class", d.storage_class());
+            write_template(d);
+        }
+
+        void write_function_params(const FunctionDecl &d) {
+            key("parameters");
+            const NameTypeVector &params = d.fields();
+            array(params.size());
+            for(NameTypeVector::const_iterator i = params.begin();
+                i != params.end(); i++) {
+                open("parameter");
+                field("name", (*i).first);
+                key("type");
+                write(*(*i).second);
+                close();
+            }
+        }
+
+        void write_function_return(const FunctionDecl &d) {
+            key("return-type");
+            write(d.return_type());
+            close();
+        }
+
+
+    public:
+        CBOROutputDriver(std::ostream *os)
+            : OutputDriver(os) { }
+
+        using OutputDriver::write;
+
+        // Self-described CBOR, and a stringref namespace around an
+        // array of indefinite length
+        virtual void write_header() {
+            static const char header[] = { (char)0xd9, (char)0xd9, (char)0xf7,
+                                           (char)0xd9, (char)0x01, (char)0x00,
+                                           (char)0x9f };
+            raw(header, sizeof(header));
+        }
+
+        virtual void write_footer() {
+            byte(0xff);
+        }
+
+        virtual void write_comment(const char *str) {
+            open("comment");
+            field("text", str);
+            close();
+        }
+
+        virtual void write_namespace(const std::string &ns) {
+            open("namespace");
+            field("name", ns);
+            close();
+        }
+
+        // Types -----------------------------------------------------------
+        virtual void write(const SimpleType &t) {
+            open(t.name());
+            close();
+        }
+
+        virtual void write(const BasicType &t) {
+            open(t.name());
+            field("bit-size", t.bit_size());
+            field("bit-alignment", t.bit_alignment());
+            close();
+        }
+
+        virtual void write(const BitfieldType &t) {
+            open(":bitfield");
+            field("width", t.width());
+            key("type");
+            write(*t.base());
+            close();
+        }
+
+        virtual void write(const PointerType &t) {
+            open(":pointer");
+            key("type");
+            write(t.pointee());
+            close();
+        }
+
+        virtual void write(const ReferenceType &t) {
+            open(":reference");
+            key("type");
+            write(t.pointee());
+            close();
+        }
+
+        virtual void write(const ArrayType &t) {
+            open(":array");
+            key("type");
+            write(t.pointee());
+            field("size", t.size());
+            close();
+        }
+
+        virtual void write(const RecordType &t) {
+            const char *type = NULL;
+
+            if(t.is_union())
+                type = ":union";
+            else if(t.is_class())
+                type = ":class";
+            else
+                type = ":struct";
+
+            open(type);
+            field("name", t.name());
+            field("id", t.id());
+            close();
+        }
+
+        virtual void write(const EnumType &t) {
+            open(":enum");
+            field("name", t.name());
+            field("id", t.id());
+            close();
+        }
+
+        virtual void write(const ComplexType &t) {
+            open(":complex");
+            key("type");
+            write(t.element());
+            close();
+        }
+
+        virtual void write(const TypeRef &t) {
+            open(":type");
+            field("id", t.id());
+            close();
+        }
+
+        virtual void write(const TypeEntry &t) {
+            open("type");
+            field("id", t.id());
+            key("type");
+            write(t.type());
+            close();
+        }
+
+        // Decls -----------------------------------------------------------
+        virtual void write(const UnhandledDecl &d) {
+            open("unhandled");
+            field("name", d.name());
+            field("kind", d.kind());
+            field("location", d.location());
+            close();
+        }
+
+        virtual void write(const VarDecl &d) {
+            open(d.is_extern() ? "extern" : "const");
+            field("name", d.name());
+            field("ns", d.ns());
+            field("location", d.location());
+            key("type");
+
+            write(d.type());
+
+            if(d.value() != "") {
+                if(d.is_string()
+                    || d.value() == "inf"
+                    || d.value() == "INF"
+                    || d.value() == "nan")
+                    field("value", d.value());
+                else {
+                    key("value");
+                    value(d.value());
+                }
+            }
+
+            close();
+        }
+
+        virtual void write(const FunctionDecl &d) {
+            write_function_header(d);
+
+            if(d.is_objc_method())
+                field("scope", d.is_class_method() ? "class" : "instance");
+
+            write_function_params(d);
+            write_function_return(d);
+        }
+
+        virtual void write(const CXXFunctionDecl &d) {
+            write_function_header(d);
+
+            field("scope", d.is_static() ? "class" : "instance");
+            field("virtual", d.is_virtual());
+            field("pure", d.is_pure());
+            field("const", d.is_const());
+
+            write_function_params(d);
+            write_function_return(d);
+        }
+
+        virtual void write(const TypedefDecl &d) {
+            open("typedef");
+            field("ns", d.ns());
+            field("name", d.name());
+            field("location", d.location());
+            key("type");
+
+            write(d.type());
+            close();
+        }
+
+        virtual void write(const RecordDecl &d) {
+            open(d.is_union() ? "union" : "struct");
+            field("ns", d.ns());
+            field("name", d.name());
+            field("id", d.id());
+            field("location", d.location());
+            field("bit-size", d.bit_size());
+            field("bit-alignment", d.bit_alignment());
+            key("fields");
+
+            write_fields(d.fields());
+            close();
+        }
+
+        virtual void write(const CXXRecordDecl &d) {
+            const char *type = d.is_union() ? "union" :
+                (d.is_class() ? "class" : "struct");
+
+            open(type);
+            field("ns", d.ns());
+            field("name", d.name());
+            field("id", d.id());
+            field("location", d.location());
+            field("bit-size", d.bit_size());
+            field("bit-alignment", d.bit_alignment());
+
+            write_template(d);
+
+            key("parents");
+
+            const CXXRecordDecl::ParentRecordVector &parents = d.parents();
+            array(parents.size());
+            for(CXXRecordDecl::ParentRecordVector::const_iterator i
+                    = parents.begin();
+                i != parents.end(); ++i) {
+                open("class");
+                field("name", (*i).name);
+                field("offset", (*i).parent_offset);
+                field("is_virtual", (*i).is_virtual);
+
+                switch((*i).access) {
+                    case CXXRecordDecl::access_private:
+                        field("access", "private"); break;
+                    case CXXRecordDecl::access_protected:
+                        field("access", "protected"); break;
+                    case CXXRecordDecl::access_public:
+                        field("access", "public"); break;
+                    default:
+                        field("access", "unknown");
+                }
+
+                close();
+            }
+
+            key("fields");
+            write_fields(d.fields());
+            key("methods");
+            write_functions(d.functions());
+            close();
+        }
+
+        virtual void write(const CXXNamespaceDecl &d) {
+            open("namespace");
+            field("ns", d.ns());
+            field("name", d.name());
+            field("id", d.id());
+            close();
+        }
+
+        virtual void write(const EnumDecl &d) {
+            open("enum");
+            field("ns", d.ns());
+            field("name", d.name());
+            field("id", d.id());
+            field("location", d.location());
+            key("fields");
+
+            const NameNumVector &fields = d.fields();
+            array(fields.size());
+            for(NameNumVector::const_iterator i = fields.begin();
+                i != fields.end(); ++i) {
+                open("field");
+                field("name", i->first);
+                field("value", i->second);
+                close();
+            }
+
+            close();
+        }
+
+        virtual void write(const ObjCInterfaceDecl &d) {
+            open(d.is_forward() ? "@class" : "@interface");
+            field("name", d.name());
+            field("location", d.location());
+            field("superclass", d.super());
+            key("protocols");
+
+            const NameVector &protos = d.protocols();
+            array(protos.size());
+            for(NameVector::const_iterator i = protos.begin();
+                i != protos.end(); i++)
+                str(*i);
+
+            key("ivars");
+            write_fields(d.fields());
+
+            key("methods");
+            write_functions(d.functions());
+
+            close();
+        }
+
+        virtual void write(const ObjCCategoryDecl &d) {
+            open("@category");
+            field("name", d.name());
+            field("location", d.location());
+            field("category", d.category());
+            key("methods");
+            write_functions(d.functions());
+            close();
+        }
+
+        virtual void write(const ObjCProtocolDecl &d) {
+            open("@protocol");
+            field("name", d.name());
+            field("location", d.location());
+            key("methods");
+            write_functions(d.functions());
+            close();
+        }
+    };
+
+    OutputDriver* MakeCBOROutputDriver(std::ostream *os) {
+        return new CBOROutputDriver(os);
+    }
+}
@@ -21,244 +21,322 @@
 
 #include "c2ffi.h"
 
-#include <sstream>
-#include <stdarg.h>
-#include <iomanip>
+#include <charconv>
+#include <cstring>
+#include <streambuf>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
 
 using namespace c2ffi;
 
-namespace c2ffi {
-    class JSONOutputDriver : public OutputDriver {
-        void write_object(const char *type, bool open, bool close, ...) {
-            va_list ap;
-            char *ptr = NULL;
+/* How many bytes from p can be copied as they are: printable ASCII
+   (and DEL), except for '"' and '\\'.  Strings are mostly clean, so
+   this checks 16 bytes at a time where it can. */
+static size_t clean_prefix(const char *p, size_t n) {
+    size_t i = 0;
+
+#if defined(__SSE2__)
+    // Compared as signed, bytes under 32 and over 127 are both < 32
+    const __m128i space = _mm_set1_epi8(32);
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+
+    for(; i + 16 <= n; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(p + i));
+        __m128i m = _mm_or_si128(_mm_cmplt_epi8(v, space),
+                                 _mm_or_si128(_mm_cmpeq_epi8(v, quote),
+                                              _mm_cmpeq_epi8(v, backslash)));
+
+        if(int bits = _mm_movemask_epi8(m))
+            return i + __builtin_ctz(bits);
+    }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+    const uint8x16_t space = vdupq_n_u8(32);
+    const uint8x16_t del = vdupq_n_u8(127);
+    const uint8x16_t quote = vdupq_n_u8('"');
+    const uint8x16_t backslash = vdupq_n_u8('\\');
+
+    // Find the block, then the byte in it below
+    for(; i + 16 <= n; i += 16) {
+        uint8x16_t v = vld1q_u8((const uint8_t*)(p + i));
+        uint8x16_t m = vorrq_u8(vorrq_u8(vcltq_u8(v, space), vcgtq_u8(v, del)),
+                                vorrq_u8(vceqq_u8(v, quote), vceqq_u8(v, backslash)));
+
+        if(vmaxvq_u8(m))
+            break;
+    }
+#endif
 
-            va_start(ap, close);
+    for(; i < n; i++) {
+        unsigned char c = p[i];
 
-            if(open) os() << "{ \"tag\": \"" << type << "\"";
-            while((ptr = va_arg(ap, char*))) {
-                os() << ", \"" << ptr << "\": ";
+        if(c < 32 || c > 127 || c == '"' || c == '\\')
+            break;
+    }
 
-                if((ptr = va_arg(ap, char*)))
-                    os() << ptr;
-                else
-                    break;
-            }
-            if(close) os() << " }";
+    return i;
+}
 
-            va_end(ap);
+namespace c2ffi {
+    class JSONOutputDriver : public OutputDriver {
+        /* Everything is written straight into the output's streambuf,
+           which does the buffering: numbers are formatted on the stack
+           and strings escaped as they're copied, so nothing here
+           allocates. */
+        void raw(const char *s, size_t n) {
+            if(os().rdbuf()->sputn(s, n) != (std::streamsize)n)
+                os().setstate(std::ios::badbit);
         }
 
-        std::string hex_str(unsigned char c) {
-            std::ostringstream ss;
-            ss.setf(std::ios::hex, std::ios::basefield);
-            ss << "\\u00" << std::setw(2) << std::setfill('0') << (int)c;
+        void raw(const char *s) { raw(s, strlen(s)); }
+        void raw(const std::string &s) { raw(s.data(), s.size()); }
 
-            return ss.str();
+        void raw(char c) {
+            if(std::char_traits<char>::eq_int_type(os().rdbuf()->sputc(c),
+                                                   std::char_traits<char>::eof()))
+                os().setstate(std::ios::badbit);
         }
 
-        std::string escape_string(std::string s) {
-            for(size_t i = s.find('\\'); i != std::string::npos;
-                i = s.find('\\', i+2))
-                s.replace(i, 1, "\\\\");
+        template<typename T> void num(T v) {
+            char buf[24];
+            std::to_chars_result r = std::to_chars(buf, buf + sizeof(buf), v);
+            raw(buf, r.ptr - buf);
+        }
+
+        void boolean(bool v) { raw(v ? "true" : "false"); }
+
+        // A JSON string; bytes outside printable ASCII are escaped one
+        // by one, as \u00XX
+        void qstr(const std::string &s) {
+            static const char hex[] = "0123456789abcdef";
+            const char *p = s.data(), *end = p + s.size();
+
+            raw('"');
+
+            for(;;) {
+                size_t n = clean_prefix(p, end - p);
+                raw(p, n);
+                p += n;
+
+                if(p == end)
+                    break;
 
-            for(size_t i = s.find('\"'); i != std::string::npos;
-                i = s.find('\"', i+2))
-                s.replace(i, 1, "\\\"");
+                unsigned char c = *p++;
 
-            for(size_t i = 0; i < s.size(); i++)
-                if((unsigned char)(s[i]) > 127 ||
-                   (unsigned char)(s[i]) < 32) {
-                    s.replace(i, 1, hex_str(s[i]));
-                    i += 5;
+                if(c == '"' || c == '\\') {
+                    char esc[2] = { '\\', (char)c };
+                    raw(esc, 2);
+                } else {
+                    char esc[6] = { '\\', 'u', '0', '0', hex[c >> 4], hex[c & 15] };
+                    raw(esc, 6);
                 }
+            }
 
-            return s;
+            raw('"');
         }
 
-        template<typename T> std::string str(T v) {
-            std::stringstream ss;
-            ss << v;
-            return ss.str();
+        /* With json-lines, objects are written without spaces, and each
+           top-level one ends its line; there's nothing around or
+           between them. */
+        bool _lines;
+        int _depth;
+
+        // { "tag": "TAG"
+        void open(const char *tag) {
+            _depth++;
+            raw(_lines ? "{\"tag\":\"" : "{ \"tag\": \"");
+            raw(tag);
+            raw('"');
+        }
+
+        void open(const std::string &tag) { open(tag.c_str()); }
+
+        // , "NAME": and then the value
+        void key(const char *name) {
+            raw(_lines ? ",\"" : ", \"");
+            raw(name);
+            raw(_lines ? "\":" : "\": ");
         }
 
-        template<typename T> std::string qstr(T v) {
-            std::stringstream ss;
-            ss << '"' << escape_string(v) << '"';
-            return ss.str();
+        void close() {
+            raw(_lines ? "}" : " }");
+            if(--_depth == 0 && _lines) raw('\n');
         }
 
+        // Between array elements
+        void sep() { raw(_lines ? "," : ", "); }
+
+        void field(const char *name, const std::string &v) { key(name); qstr(v); }
+        void field(const char *name, bool v) { key(name); boolean(v); }
+        template<typename T> void field(const char *name, T v) { key(name); num(v); }
+
         void write_fields(const NameTypeVector &fields) {
-            os() << '[';
+            raw('[');
             for(NameTypeVector::const_iterator i = fields.begin();
                 i != fields.end(); i++) {
                 if(i != fields.begin())
-                    os() << ", ";
-
-                write_object("field", 1, 0,
-                             "name", qstr(i->first).c_str(),
-                             "bit-offset", str(i->second->bit_offset()).c_str(),
-                             "bit-size", str(i->second->bit_size()).c_str(),
-                             "bit-alignment", str(i->second->bit_alignment()).c_str(),
-                             "type", NULL);
+                    sep();
+
+                open("field");
+                field("name", i->first);
+                field("bit-offset", i->bit_offset);
+                field("bit-size", i->bit_size);
+                field("bit-alignment", i->bit_alignment);
+                key("type");
                 write(*(i->second));
-                write_object("", 0, 1, NULL);
+                close();
             }
 
-            os() << ']';
+            raw(']');
         }
 
         void write_template(const TemplateMixin &d) {
             if(d.is_template()) {
-                write_object("", 0, 0,
-                             "template", NULL);
-                os() << "[";
+                key("template");
+                raw("[");
                 for(TemplateArgVector::const_iterator i =
                         d.args().begin();
                     i != d.args().end(); ++i) {
                     if(i != d.args().begin())
-                        os() << ", ";
+                        sep();
 
-                    write_object("parameter", 1, 0,
-                                 "type", NULL);
+                    open("parameter");
+                    key("type");
                     write(*((*i)->type()));
 
                     if((*i)->has_val())
-                        write_object("", 0, 0,
-                                     "value", qstr((*i)->val()).c_str(),
-                                     NULL);
+                        field("value", (*i)->val());
 
-                    write_object("", 0, 1, NULL);
+                    close();
                 }
-                os() << "]";
+                raw("]");
             }
         }
 
         void write_functions(const FunctionVector &funcs) {
-            os() << '[';
+            raw('[');
             for(FunctionVector::const_iterator i = funcs.begin();
                 i != funcs.end(); i++) {
                 if(i != funcs.begin())
-                    os() << ", ";
+                    sep();
                 write((const Writable&)*(*i));
             }
-            os() << ']';
+            raw(']');
         }
 
         void write_function_header(const FunctionDecl &d) {
-            const char *variadic = d.is_variadic() ? "true" : "false";
-            const char *inline_ = d.is_inline() ? "true" : "false";
-
-            write_object("function", 1, 0,
-                         "name", qstr(d.name()).c_str(),
-                         "ns", str(d.ns()).c_str(),
-                         "location", qstr(d.location()).c_str(),
-                         "variadic", variadic,
-                         "inline", inline_,
-                         "storage-class", qstr(d.storage_class()).c_str(),
-                         NULL);
+            open("function");
+            field("name", d.name());
+            field("ns", d.ns());
+            field("location", d.location());
+            field("variadic", d.is_variadic());
+            field("inline", d.is_inline());
+            field("storage-class", d.storage_class());
             write_template(d);
         }
 
         void write_function_params(const FunctionDecl &d) {
-            write_object("", 0, 0, "parameters", NULL);
-            os() << "[";
+            key("parameters");
+            raw("[");
             const NameTypeVector &params = d.fields();
             for(NameTypeVector::const_iterator i = params.begin();
                 i != params.end(); i++) {
                 if(i != params.begin())
-                    os() << ", ";
+                    sep();
 
-                write_object("parameter", 1, 0,
-                             "name", qstr((*i).first).c_str(),
-                             "type", NULL);
+                open("parameter");
+                field("name", (*i).first);
+                key("type");
                 write(*(*i).second);
-                write_object("", 0, 1, NULL);
+                close();
             }
 
-            os() << "]";
+            raw("]");
         }
 
         void write_function_return(const FunctionDecl &d) {
-            write_object("", 0, 0,
-                         "return-type", NULL);
+            key("return-type");
             write(d.return_type());
-            write_object("", 0, 1, NULL);
+            close();
         }
 
 
     public:
-        JSONOutputDriver(std::ostream *os)
-            : OutputDriver(os) { }
+        JSONOutputDriver(std::ostream *os, bool lines)
+            : OutputDriver(os), _lines(lines), _depth(0) { }
 
         using OutputDriver::write;
 
         virtual void write_header() {
-            os() << "[" << std::endl;
+            if(!_lines) raw("[\n");
         }
 
         virtual void write_between() {
-            os() << "," << std::endl;
+            if(!_lines) raw(",\n");
         }
 
         virtual void write_footer() {
-            os() << "\n]" << std::endl;
+            if(!_lines) raw("\n]\n");
         }
 
         virtual void write_comment(const char *str) {
-            write_object("comment", 1, 1,
-                         "text", qstr(str).c_str(),
-                         NULL);
+            open("comment");
+            field("text", std::string(str));
+            close();
         }
 
         virtual void write_namespace(const std::string &ns) {
-            write_object("namespace", 1, 1,
-                         "name", qstr(ns).c_str(),
-                         NULL);
+            open("namespace");
+            field("name", ns);
+            close();
             write_between();
         }
 
         // Types -----------------------------------------------------------
         virtual void write(const SimpleType &t) {
-            write_object(t.name().c_str(), 1, 1, NULL);
+            open(t.name());
+            close();
         }
 
         virtual void write(const BasicType &t) {
-            write_object(t.name().c_str(), 1, 1,
-                         "bit-size", str(t.bit_size()).c_str(),
-                         "bit-alignment", str(t.bit_alignment()).c_str(),
-                         NULL);
+            open(t.name());
+            field("bit-size", t.bit_size());
+            field("bit-alignment", t.bit_alignment());
+            close();
         }
 
         virtual void write(const BitfieldType &t) {
-            write_object(":bitfield", 1, 0,
-                         "width", str(t.width()).c_str(),
-                         "type", NULL);
+            open(":bitfield");
+            field("width", t.width());
+            key("type");
             write(*t.base());
-            write_object("", 0, 1, NULL);
+            close();
         }
 
         virtual void write(const PointerType &t) {
-            write_object(":pointer", 1, 0,
-                         "type", NULL);
+            open(":pointer");
+            key("type");
             write(t.pointee());
-            write_object("", 0, 1, NULL);
+            close();
         }
 
         virtual void write(const ReferenceType &t) {
-            write_object(":reference", 1, 0,
-                         "type", NULL);
+            open(":reference");
+            key("type");
             write(t.pointee());
-            write_object("", 0, 1, NULL);
+            close();
         }
 
         virtual void write(const ArrayType &t) {
-            write_object(":array", 1, 0,
-                         "type", NULL);
+            open(":array");
+            key("type");
             write(t.pointee());
-            write_object("", 0, 1,
-                         "size", str(t.size()).c_str(),
-                         NULL);
+            field("size", t.size());
+            close();
         }
 
         virtual void write(const RecordType &t) {
@@ -271,43 +349,55 @@ namespace c2ffi {
             else
                 type = ":struct";
 
-            write_object(type, 1, 1,
-                         "name", qstr(t.name()).c_str(),
-                         "id", str(t.id()).c_str(),
-                         NULL);
+            open(type);
+            field("name", t.name());
+            field("id", t.id());
+            close();
         }
 
         virtual void write(const EnumType &t) {
-            write_object(":enum", 1, 1,
-                         "name", qstr(t.name()).c_str(),
-                         "id", str(t.id()).c_str(),
-                         NULL);
+            open(":enum");
+            field("name", t.name());
+            field("id", t.id());
+            close();
         }
 
         virtual void write(const ComplexType &t) {
-            write_object(":complex", 1, 0,
-                         "type", NULL);
+            open(":complex");
+            key("type");
             write(t.element());
-            write_object("", 0, 1, NULL);
+            close();
+        }
+
+        virtual void write(const TypeRef &t) {
+            open(":type");
+            field("id", t.id());
+            close();
+        }
+
+        virtual void write(const TypeEntry &t) {
+            open("type");
+            field("id", t.id());
+            key("type");
+            write(t.type());
+            close();
         }
 
         // Decls -----------------------------------------------------------
         virtual void write(const UnhandledDecl &d) {
-            write_object("unhandled", 1, 1,
-                         "name", qstr(d.name()).c_str(),
-                         "kind", qstr(d.kind()).c_str(),
-                         "location", qstr(d.location()).c_str(),
-                         NULL);
+            open("unhandled");
+            field("name", d.name());
+            field("kind", d.kind());
+            field("location", d.location());
+            close();
         }
 
         virtual void write(const VarDecl &d) {
-            const char *type = d.is_extern() ? "extern" : "const";
-
-            write_object(type, 1, 0,
-                         "name", qstr(d.name()).c_str(),
-                         "ns", str(d.ns()).c_str(),
-                         "location", qstr(d.location()).c_str(),
-                         "type", NULL);
+            open(d.is_extern() ? "extern" : "const");
+            field("name", d.name());
+            field("ns", d.ns());
+            field("location", d.location());
+            key("type");
 
             write(d.type());
 
@@ -316,25 +406,23 @@ namespace c2ffi {
                     || d.value() == "inf"
                     || d.value() == "INF"
                     || d.value() == "nan")
-                    write_object("", 0, 0,
-                                 "value", qstr(d.value()).c_str(),
-                                 NULL);
-                else
-                    write_object("", 0, 0,
-                                 "value", str(d.value()).c_str(),
-                                 NULL);
+                    field("value", d.value());
+                else {
+                    key("value");
+                    raw(d.value());
+                }
             }
 
-            write_object("", 0, 1, NULL);
+            close();
         }
 
         virtual void write(const FunctionDecl &d) {
             write_function_header(d);
 
-            if(d.is_objc_method())
-                write_object("", 0, 0,
-                             "scope", d.is_class_method() ? "\"class\"" : "\"instance\"",
-                             NULL);
+            if(d.is_objc_method()) {
+                key("scope");
+                raw(d.is_class_method() ? "\"class\"" : "\"instance\"");
+            }
 
             write_function_params(d);
             write_function_return(d);
@@ -343,185 +431,179 @@ namespace c2ffi {
         virtual void write(const CXXFunctionDecl &d) {
             write_function_header(d);
 
-            write_object("", 0, 0,
-                         "scope", d.is_static() ? "\"class\"" : "\"instance\"",
-                         "virtual", d.is_virtual() ? "true" : "false",
-                         "pure", d.is_pure() ? "true" : "false",
-                         "const", d.is_const() ? "true" : "false",
-                         NULL);
+            key("scope");
+            raw(d.is_static() ? "\"class\"" : "\"instance\"");
+            field("virtual", d.is_virtual());
+            field("pure", d.is_pure());
+            field("const", d.is_const());
 
             write_function_params(d);
             write_function_return(d);
         }
 
         virtual void write(const TypedefDecl &d) {
-            write_object("typedef", 1, 0,
-                         "ns", str(d.ns()).c_str(),
-                         "name", qstr(d.name()).c_str(),
-                         "location", qstr(d.location()).c_str(),
-                         "type", NULL);
+            open("typedef");
+            field("ns", d.ns());
+            field("name", d.name());
+            field("location", d.location());
+            key("type");
 
             write(d.type());
-            write_object("", 0, 1, NULL);
+            close();
         }
 
         virtual void write(const RecordDecl &d) {
-            const char *type = d.is_union() ? "union" : "struct";
-
-            write_object(type, 1, 0,
-                         "ns", str(d.ns()).c_str(),
-                         "name", qstr(d.name()).c_str(),
-                         "id", str(d.id()).c_str(),
-                         "location", qstr(d.location()).c_str(),
-                         "bit-size", str(d.bit_size()).c_str(),
-                         "bit-alignment", str(d.bit_alignment()).c_str(),
-                         "fields", NULL);
+            open(d.is_union() ? "union" : "struct");
+            field("ns", d.ns());
+            field("name", d.name());
+            field("id", d.id());
+            field("location", d.location());
+            field("bit-size", d.bit_size());
+            field("bit-alignment", d.bit_alignment());
+            key("fields");
 
             write_fields(d.fields());
-            write_object("", 0, 1, NULL);
+            close();
         }
 
         virtual void write(const CXXRecordDecl &d) {
             const char *type = d.is_union() ? "union" :
                 (d.is_class() ? "class" : "struct");
 
-            write_object(type, 1, 0,
-                         "ns", str(d.ns()).c_str(),
-                         "name", qstr(d.name()).c_str(),
-                         "id", str(d.id()).c_str(),
-                         "location", qstr(d.location()).c_str(),
-                         "bit-size", str(d.bit_size()).c_str(),
-                         "bit-alignment", str(d.bit_alignment()).c_str(),
-                         NULL);
+            open(type);
+            field("ns", d.ns());
+            field("name", d.name());
+            field("id", d.id());
+            field("location", d.location());
+            field("bit-size", d.bit_size());
+            field("bit-alignment", d.bit_alignment());
 
             write_template(d);
 
-            write_object("", 0, 0,
-                         "parents", NULL);
+            key("parents");
 
-            os() << "[";
+            raw("[");
 
             const CXXRecordDecl::ParentRecordVector &parents = d.parents();
             for(CXXRecordDecl::ParentRecordVector::const_iterator i
                     = parents.begin();
                 i != parents.end(); ++i) {
                 if(i != parents.begin())
-                    os() << ", ";
+                    sep();
 
-                write_object("class", 1, 0,
-                             "name", qstr((*i).name).c_str(),
-                             "offset", str((*i).parent_offset).c_str(),
-                             "is_virtual", ((*i).is_virtual ? "true" : "false"),
-                             "access", NULL);
+                open("class");
+                field("name", (*i).name);
+                field("offset", (*i).parent_offset);
+                field("is_virtual", (*i).is_virtual);
+                key("access");
 
                 switch((*i).access) {
                     case CXXRecordDecl::access_private:
-                        os() << "\"private\""; break;
+                        raw("\"private\""); break;
                     case CXXRecordDecl::access_protected:
-                        os() << "\"protected\""; break;
+                        raw("\"protected\""); break;
                     case CXXRecordDecl::access_public:
-                        os() << "\"public\""; break;
+                        raw("\"public\""); break;
                     default:
-                        os() << "\"unknown\"";
+                        raw("\"unknown\"");
                 }
 
-                write_object("", 0, 1, NULL);
+                close();
             }
 
-            os() << "]";
-
-            write_object("", 0, 0,
-                         "fields", NULL);
+            raw("]");
 
+            key("fields");
             write_fields(d.fields());
-            write_object("", 0, 0,
-                         "methods", NULL);
+            key("methods");
             write_functions(d.functions());
-            write_object("", 0, 1, NULL);
+            close();
         }
 
         virtual void write(const CXXNamespaceDecl &d) {
-            write_object("namespace", 1, 1,
-                         "ns", str(d.ns()).c_str(),
-                         "name", qstr(d.name()).c_str(),
-                         "id", str(d.id()).c_str(),
-                         NULL);
+            open("namespace");
+            field("ns", d.ns());
+            field("name", d.name());
+            field("id", d.id());
+            close();
         }
 
         virtual void write(const EnumDecl &d) {
-            write_object("enum", 1, 0,
-                         "ns", str(d.ns()).c_str(),
-                         "name", qstr(d.name()).c_str(),
-                         "id", str(d.id()).c_str(),
-                         "location", qstr(d.location()).c_str(),
-                         "fields", NULL);
-
-            os() << "[";
+            open("enum");
+            field("ns", d.ns());
+            field("name", d.name());
+            field("id", d.id());
+            field("location", d.location());
+            key("fields");
+
+            raw("[");
             const NameNumVector &fields = d.fields();
             for(NameNumVector::const_iterator i = fields.begin();
                 i != fields.end(); ++i) {
                 if(i != fields.begin())
-                    os() << ", ";
+                    sep();
 
-                write_object("field", 1, 1,
-                             "name", qstr(i->first).c_str(),
-                             "value", str(i->second).c_str(),
-                             NULL);
+                open("field");
+                field("name", i->first);
+                field("value", i->second);
+                close();
             }
 
-            os() << "]";
-            write_object("", 0, 1, NULL);
+            raw("]");
+            close();
         }
 
         virtual void write(const ObjCInterfaceDecl &d) {
-            write_object(d.is_forward() ? "@class" : "@interface", 1, 0,
-                         "name", qstr(d.name()).c_str(),
-                         "location", qstr(d.location()).c_str(),
-                         "superclass", qstr(d.super()).c_str(),
-                         "protocols", NULL);
+            open(d.is_forward() ? "@class" : "@interface");
+            field("name", d.name());
+            field("location", d.location());
+            field("superclass", d.super());
+            key("protocols");
 
-            os() << "[";
+            raw("[");
             const NameVector &protos = d.protocols();
             for(NameVector::const_iterator i = protos.begin();
                 i != protos.end(); i++) {
                 if(i != protos.begin())
-                    os() << ", ";
-                os() << qstr(*i).c_str();
+                    sep();
+                qstr(*i);
             }
-            os() << "]";
+            raw("]");
 
-            write_object("", 0, 0,
-                         "ivars", NULL);
+            key("ivars");
             write_fields(d.fields());
 
-            write_object("", 0, 0,
-                         "methods", NULL);
+            key("methods");
             write_functions(d.functions());
 
-            write_object("", 0, 1, NULL);
+            close();
         }
 
         virtual void write(const ObjCCategoryDecl &d) {
-            write_object("@category", 1, 0,
-                         "name", qstr(d.name()).c_str(),
-                         "location", qstr(d.location()).c_str(),
-                         "category", qstr(d.category()).c_str(),
-                         "methods", NULL);
+            open("@category");
+            field("name", d.name());
+            field("location", d.location());
+            field("category", d.category());
+            key("methods");
             write_functions(d.functions());
-            write_object("", 0, 1, NULL);
+            close();
         }
 
         virtual void write(const ObjCProtocolDecl &d) {
-            write_object("@protocol", 1, 0,
-                         "name", qstr(d.name()).c_str(),
-                         "location", qstr(d.location()).c_str(),
-                         "methods", NULL);
+            open("@protocol");
+            field("name", d.name());
+            field("location", d.location());
+            key("methods");
             write_functions(d.functions());
-            write_object("", 0, 1, NULL);
+            close();
         }
     };
 
     OutputDriver* MakeJSONOutputDriver(std::ostream *os) {
-        return new JSONOutputDriver(os);
+        return new JSONOutputDriver(os, false);
+    }
+
+    OutputDriver* MakeJSONLinesOutputDriver(std::ostream *os) {
+        return new JSONOutputDriver(os, true);
     }
 }
@@ -0,0 +1,134 @@
+/* -*- c++ -*-
+
+   c2ffi
+   Copyright (C) 2013  Ryan Pavlik
+
+   This file is part of c2ffi.
+
+   c2ffi is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 2 of the License, or
+   (at your option) any later version.
+
+   c2ffi is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with c2ffi.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "c2ffi.h"
+#include "c2ffi/sink.h"
+
+using namespace c2ffi;
+
+/*
+   Not selectable with -D; this forwards everything to each driver given
+   with "-D driver:path", so one parse can produce several outputs.
+ */
+
+#define FORWARD(call)                                                   \
+    for(DriverVector::iterator i = _drivers.begin();                    \
+        i != _drivers.end(); ++i)                                       \
+        (*i)->call
+
+namespace c2ffi {
+    class MultiOutputDriver : public OutputDriver {
+        typedef std::vector<OutputDriver*> DriverVector;
+        typedef std::vector<FdStream*> StreamVector;
+        typedef std::vector<std::string> PathVector;
+
+        DriverVector _drivers;
+        StreamVector _streams;
+        PathVector _paths;
+        bool _closed;
+
+    public:
+        MultiOutputDriver(std::ostream *os, const DriverVector &drivers,
+                          const StreamVector &streams, const PathVector &paths)
+            : OutputDriver(os), _drivers(drivers), _streams(streams),
+              _paths(paths), _closed(false) { }
+
+        virtual ~MultiOutputDriver() {
+            if(!_closed)
+                close();
+
+            for(DriverVector::iterator i = _drivers.begin();
+                i != _drivers.end(); ++i)
+                delete *i;
+
+            for(StreamVector::iterator i = _streams.begin();
+                i != _streams.end(); ++i)
+                delete *i;
+        }
+
+        virtual void write_header() { FORWARD(write_header()); }
+        virtual void write_namespace(const std::string &ns) { FORWARD(write_namespace(ns)); }
+        virtual void write_between() { FORWARD(write_between()); }
+        virtual void write_footer() { FORWARD(write_footer()); }
+        virtual void write_comment(const char *text) { FORWARD(write_comment(text)); }
+        virtual void flush() { FORWARD(flush()); }
+
+        virtual bool close() {
+            bool ok = true;
+
+            FORWARD(flush());
+
+            for(size_t i = 0; i < _streams.size(); i++) {
+                if(!_streams[i]->close()) {
+                    std::cerr << "Error: Could not write output file: "
+                              << _paths[i] << std::endl;
+                    ok = false;
+                }
+            }
+
+            _closed = true;
+            return ok;
+        }
+
+        // Each driver dispatches on its own, so nested writes never
+        // come back here.
+        virtual void write(const Writable &w) { FORWARD(write(w)); }
+
+        // Types -----------------------------------------------------------
+        virtual void write(const SimpleType &t) { FORWARD(write(t)); }
+        virtual void write(const BasicType &t) { FORWARD(write(t)); }
+        virtual void write(const BitfieldType &t) { FORWARD(write(t)); }
+        virtual void write(const PointerType &t) { FORWARD(write(t)); }
+        virtual void write(const ArrayType &t) { FORWARD(write(t)); }
+        virtual void write(const RecordType &t) { FORWARD(write(t)); }
+        virtual void write(const EnumType &t) { FORWARD(write(t)); }
+        virtual void write(const ReferenceType &t) { FORWARD(write(t)); }
+        virtual void write(const TemplateType &t) { FORWARD(write(t)); }
+        virtual void write(const ComplexType &t) { FORWARD(write(t)); }
+        virtual void write(const TypeRef &t) { FORWARD(write(t)); }
+        virtual void write(const TypeEntry &t) { FORWARD(write(t)); }
+
+        // Decls -----------------------------------------------------------
+        virtual void write(const UnhandledDecl &d) { FORWARD(write(d)); }
+        virtual void write(const VarDecl &d) { FORWARD(write(d)); }
+        virtual void write(const FunctionDecl &d) { FORWARD(write(d)); }
+        virtual void write(const TypedefDecl &d) { FORWARD(write(d)); }
+        virtual void write(const RecordDecl &d) { FORWARD(write(d)); }
+        virtual void write(const EnumDecl &d) { FORWARD(write(d)); }
+        virtual void write(const CXXRecordDecl &d) { FORWARD(write(d)); }
+        virtual void write(const CXXFunctionDecl &d) { FORWARD(write(d)); }
+        virtual void write(const CXXNamespaceDecl &d) { FORWARD(write(d)); }
+        virtual void write(const ObjCInterfaceDecl &d) { FORWARD(write(d)); }
+        virtual void write(const ObjCCategoryDecl &d) { FORWARD(write(d)); }
+        virtual void write(const ObjCProtocolDecl &d) { FORWARD(write(d)); }
+    };
+
+    OutputDriver* MakeMultiOutputDriver(std::ostream *os,
+                                        const std::vector<OutputDriver*> &drivers,
+                                        const std::vector<FdStream*> &streams,
+                                        const std::vector<std::string> &paths) {
+        return new MultiOutputDriver(os, drivers, streams, paths);
+    }
+}
@@ -27,7 +27,7 @@ namespace c2ffi {
     class SexpOutputDriver : public OutputDriver {
         int _level;
 
-        void endl() { if(_level <= 1) os() << std::endl; }
+        void endl() { if(_level <= 1) os() << '\n'; }
 
         void write_fields(const NameTypeVector &fields,
                           std::string pre = "",
@@ -35,12 +35,12 @@ namespace c2ffi {
             std::string spaces(_level * 2, ' ');
             std::string spaces_pad(pre.size(), ' ');
 
-            os() << std::endl << spaces << pre;
+            os() << '\n' << spaces << pre;
 
             for(NameTypeVector::const_iterator i = fields.begin();
                 i != fields.end(); i++) {
                 if(i != fields.begin())
-                    os() << std::endl << spaces << spaces_pad;
+                    os() << '\n' << spaces << spaces_pad;
 
                 os()  << "(" << i->first << " ";
                 write(*(i->second));
@@ -53,12 +53,12 @@ namespace c2ffi {
         void write_functions(const FunctionVector &funcs) {
             std::string spaces(_level * 2, ' ');
 
-            os() << std::endl << spaces << '(';
+            os() << '\n' << spaces << '(';
 
             for(FunctionVector::const_iterator i = funcs.begin();
                 i != funcs.end(); i++) {
                 if(i != funcs.begin())
-                    os() << std::endl << spaces << " ";
+                    os() << '\n' << spaces << " ";
 
                 if((*i)->is_objc_method()) {
                     os() << "(";
@@ -89,11 +89,11 @@ namespace c2ffi {
             : OutputDriver(os), _level(0) { }
 
         virtual void write_namespace(const std::string &ns) {
-            os() << "(in-package :" << ns << ")" << std::endl;
+            os() << "(in-package :" << ns << ")\n";
         }
 
         virtual void write_comment(const char *str) {
-            os() << ";; " << str << std::endl;
+            os() << ";; " << str << '\n';
         }
 
         using OutputDriver::write;
@@ -163,12 +163,25 @@ namespace c2ffi {
             _level--;
         }
 
+        virtual void write(const TypeRef &t) {
+            os() << "(:type " << t.id() << ")";
+        }
+
+        virtual void write(const TypeEntry &t) {
+            _level++;
+            os() << "(type " << t.id() << " ";
+            write(t.type());
+            os() << ")";
+            endl();
+            _level--;
+        }
+
         // Decls -----------------------------------------------------------
         virtual void write(const UnhandledDecl &d) {
             _level++;
             os() << ";; Unhandled: <" << d.kind() << "> " << d.name()
                  << " " << d.location();
-            os() << std::endl;
+            os() << '\n';
             _level--;
         }
 
@@ -264,7 +277,7 @@ namespace c2ffi {
             const NameNumVector &fields = d.fields();
             for(NameNumVector::const_iterator i = fields.begin();
                 i != fields.end(); i++) {
-                os() << std::endl
+                os() << '\n'
                      << "    (" << i->first << " " << i->second
                      << ")";
             }
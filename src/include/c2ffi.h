@@ -24,6 +24,7 @@
 
 #include <iostream>
 #include <string>
+#include <vector>
 
 #include "c2ffi/predecl.h"
 
@@ -59,6 +60,13 @@ namespace c2ffi {
 
         virtual void write_comment(const char *text) { }
 
+        // Called once all output has been written
+        virtual void flush() { _os->flush(); }
+
+        // Close any files this driver opened itself; false if writing
+        // one of them failed
+        virtual bool close() { return true; }
+
         virtual void write(const SimpleType&) = 0;
         virtual void write(const BasicType&) = 0;
         virtual void write(const BitfieldType&) = 0;
@@ -69,6 +77,8 @@ namespace c2ffi {
         virtual void write(const ReferenceType&) { }
         virtual void write(const TemplateType&) { }
         virtual void write(const ComplexType&) = 0;
+        virtual void write(const TypeRef&) { }
+        virtual void write(const TypeEntry&) { }
 
         virtual void write(const UnhandledDecl &d) = 0;
         virtual void write(const VarDecl &d) = 0;
@@ -98,9 +108,30 @@ namespace c2ffi {
     struct OutputDriverField {
         const char* name;
         MakeOutputDriver fn;
+
+        // How a decl is written depends on what was written before it,
+        // so --shard-dir can't reuse it in another output
+        bool stateful;
     };
 
     extern OutputDriverField OutputDrivers[];
+
+    const OutputDriverField* find_output_driver(const std::string &name);
+
+    // One "-D driver[:path]"; an empty path writes to the main output.
+    struct OutputDriverSpec {
+        const OutputDriverField *driver;
+        std::string path;
+    };
+
+    typedef std::vector<OutputDriverSpec> OutputDriverSpecVector;
+
+    /* Make the driver for specs, writing unpathed output to os.  Several
+       specs give a driver forwarding to all of them; this returns NULL
+       if a path could not be opened.  Paths are written asynchronously
+       if async is set (see FdSink). */
+    OutputDriver* make_output_driver(const OutputDriverSpecVector &specs,
+                                     std::ostream *os, bool async);
 }
 
 #include "c2ffi/template.h"
@@ -0,0 +1,78 @@
+/*  -*- c++ -*-
+
+    c2ffi
+    Copyright (C) 2013  Ryan Pavlik
+
+    This file is part of c2ffi.
+
+    c2ffi is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    c2ffi is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with c2ffi.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef C2FFI_ARENA_H
+#define C2FFI_ARENA_H
+
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <llvm/Support/Allocator.h>
+
+namespace c2ffi {
+    /* Bump allocation for the Decl and Type graph.  Nothing made here
+       is deleted on its own, so parents don't delete their children;
+       reset() destroys everything at once, newest first, and reuses
+       the memory. */
+    class Arena {
+        typedef void (*Destroy)(void*);
+        typedef std::pair<void*, Destroy> Object;
+
+        llvm::BumpPtrAllocator _alloc;
+        std::vector<Object> _objects;
+
+        template<typename T>
+        static void destroy(void *p) { static_cast<T*>(p)->~T(); }
+
+    public:
+        Arena() { }
+        ~Arena() { reset(); }
+
+        Arena(const Arena&) = delete;
+        Arena& operator=(const Arena&) = delete;
+
+        template<typename T, typename... Args>
+        T* make(Args&&... args) {
+            void *mem = _alloc.Allocate(sizeof(T), llvm::Align(alignof(T)));
+            T *p = new(mem) T(std::forward<Args>(args)...);
+
+            if(!std::is_trivially_destructible<T>::value)
+                _objects.push_back(Object(p, &destroy<T>));
+
+            return p;
+        }
+
+        void reset() {
+            for(std::vector<Object>::reverse_iterator i = _objects.rbegin();
+                i != _objects.rend(); ++i)
+                i->second(i->first);
+
+            _objects.clear();
+            _alloc.Reset();
+        }
+
+        size_t bytes() const { return _alloc.getBytesAllocated(); }
+    };
+}
+
+#endif /* C2FFI_ARENA_H */
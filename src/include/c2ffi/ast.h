@@ -26,12 +26,19 @@
 #include <map>
 #include <clang/AST/ASTConsumer.h>
 #include "c2ffi.h"
+#include "c2ffi/arena.h"
 #include "c2ffi/opt.h"
 
 #define if_cast(v,T,e) if(T *v = llvm::dyn_cast<T>((e)))
 #define if_const_cast(v,T,e) if(const T *v = llvm::dyn_cast<T>((e)))
 
 namespace c2ffi {
+    class LocationFilter;
+    class ShardCache;
+    class Stats;
+    class SymbolSet;
+    class TypeTable;
+
     typedef std::set<const clang::Decl*> ClangDeclSet;
     typedef std::map<const clang::Decl*, int> ClangDeclIDMap;
 
@@ -50,17 +57,47 @@ namespace c2ffi {
 
         const clang::NamedDecl *_ns;
 
+        bool _pch_done;
+
+        ShardCache *_shards;
+        LocationFilter *_filter;
+        SymbolSet *_symbols;
+        TypeTable *_types;
+        TypeCache _type_cache;
+
+        // Decls, and types that can't be shared, live until the decl
+        // they were made for is written; types kept in _type_cache live
+        // as long as this
+        Arena _arena;
+        Arena _type_arena;
+
     public:
         C2FFIASTConsumer(clang::CompilerInstance &ci, config &config)
-            : _config(config), _ci(ci), _od(config.od), _mid(false), _decl_id(0), _ns() { }
+            : _config(config), _ci(ci), _od(config.od), _mid(false), _decl_id(0), _ns(),
+              _pch_done(false), _shards(NULL), _filter(NULL), _symbols(NULL), _types(NULL) { }
+
+        void set_shards(ShardCache *shards) { _shards = shards; }
+        void set_filter(LocationFilter *filter) { _filter = filter; }
+        void set_symbols(SymbolSet *symbols) { _symbols = symbols; }
+        void set_type_table(TypeTable *types) { _types = types; }
 
         clang::CompilerInstance& ci() { return _ci; }
         c2ffi::OutputDriver& od() { return *_od; }
+        Stats* stats() const { return _config.stats; }
+        TypeTable* type_table() const { return _types; }
+        TypeCache& type_cache() { return _type_cache; }
+        Arena& arena() { return _arena; }
+        Arena& type_arena() { return _type_arena; }
 
         virtual bool HandleTopLevelDecl(clang::DeclGroupRef d);
         virtual void HandleTopLevelDeclInObjCContainer(clang::DeclGroupRef d);
+        virtual void HandleInterestingDecl(clang::DeclGroupRef d);
+        virtual void HandleTranslationUnit(clang::ASTContext &ctx);
 
+        void HandlePCHDecls();
         void HandleDecl(clang::Decl *d, const clang::NamedDecl *ns = NULL);
+        void HandleMacroDecl(clang::Decl *d);
+        void HandleShardDecl(clang::Decl *d);
         void HandleDeclContext(const clang::DeclContext *dc,
                                const clang::NamedDecl *ns);
         void HandleNS(const clang::NamespaceDecl *ns);
@@ -69,17 +106,9 @@ namespace c2ffi {
         Decl* proc(const clang::Decl*, Decl*);
 
         bool is_cur_decl(const clang::Decl *d) const;
+        void add_cur_decl(const clang::Decl *d);
         unsigned int decl_id(const clang::Decl *d) const;
-        unsigned int add_decl(const clang::Decl *d) {
-            if(!d) {
-                return 0;
-            } else if(!_decl_map.count(d)) {
-                _decl_map[d] = ++_decl_id;
-                return _decl_id;
-            } else {
-                return _decl_map[d];
-            }
-        }
+        unsigned int add_decl(const clang::Decl *d);
         unsigned int add_cxx_decl(const clang::Decl *d) {
             if(d) {
                 _cxx_decls.insert(d);
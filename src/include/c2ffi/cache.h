@@ -0,0 +1,82 @@
+/*  -*- c++ -*-
+
+    c2ffi
+    Copyright (C) 2013  Ryan Pavlik
+
+    This file is part of c2ffi.
+
+    c2ffi is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    c2ffi is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with c2ffi.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef C2FFI_CACHE_H
+#define C2FFI_CACHE_H
+
+#include <sstream>
+#include <string>
+
+#include "c2ffi/opt.h"
+
+namespace c2ffi {
+    /* Hash of everything besides the input files which can change the
+       output: options, target, clang version and the c2ffi binary */
+    std::string config_key(const config &config);
+
+    // Write data to path via a temporary file, so readers never see
+    // part of it
+    bool write_file_atomic(const std::string &path, const std::string &data);
+
+    /* One lookup in config.cache_dir for config.filename.
+
+       The manifest is found from the main file and the options; it
+       records the content hash of every file the last run read, and
+       the result is only replayed if all of them still match.  On a
+       miss, capture() diverts the output streams so store() can save
+       what was written once the run has finished. */
+    class CacheEntry {
+        config &_config;
+        std::string _manifest_key;
+        bool _capturing;
+        IncludeVector _deps;
+
+        static const int NSTREAMS = 3;
+        std::ostream *_streams[NSTREAMS];
+        std::streambuf *_saved[NSTREAMS];
+        std::stringbuf _bufs[NSTREAMS];
+
+        std::string path(const std::string &key, const char *ext) const;
+        void release();
+
+    public:
+        CacheEntry(config &config);
+        ~CacheEntry();
+
+        // Can this run be cached at all?
+        static bool usable(const config &config);
+
+        /* If there is a valid result, write it to the output streams and
+           return true */
+        bool replay();
+
+        // After replay(), the files the cached run read
+        const IncludeVector& deps() const { return _deps; }
+
+        void capture();
+
+        /* Stop capturing, passing the output on, and save it along with
+           the hashes of deps, which are the files on disk the run read */
+        void store(const IncludeVector &deps);
+    };
+}
+
+#endif /* C2FFI_CACHE_H */
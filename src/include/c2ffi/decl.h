@@ -70,7 +70,6 @@ namespace c2ffi {
     public:
         TypeDecl(std::string name, Type *type)
             : Decl(name), _type(type) { }
-        virtual ~TypeDecl() { delete _type; }
 
         DEFWRITER(TypeDecl);
         virtual const Type& type() const { return *_type; }
@@ -99,7 +98,7 @@ namespace c2ffi {
     class FieldsMixin {
         NameTypeVector _v;
     public:
-        virtual ~FieldsMixin();
+        virtual ~FieldsMixin() { }
 
         void add_field(Name, Type*);
         void add_field(C2FFIASTConsumer *ast, clang::FieldDecl *f);
@@ -155,7 +154,7 @@ namespace c2ffi {
     class FunctionsMixin {
         FunctionVector _v;
     public:
-        virtual ~FunctionsMixin();
+        virtual ~FunctionsMixin() { }
 
         void add_function(FunctionDecl *f);
         const FunctionVector& functions() const { return _v; }
@@ -0,0 +1,69 @@
+/*  -*- c++ -*-
+
+    c2ffi
+    Copyright (C) 2013  Ryan Pavlik
+
+    This file is part of c2ffi.
+
+    c2ffi is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    c2ffi is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with c2ffi.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef C2FFI_FILTER_H
+#define C2FFI_FILTER_H
+
+#include <string>
+#include <vector>
+
+#include <llvm/ADT/DenseMap.h>
+#include <llvm/Support/GlobPattern.h>
+
+#include <clang/Basic/SourceLocation.h>
+
+#include "c2ffi/opt.h"
+
+namespace clang {
+    class SourceManager;
+}
+
+namespace c2ffi {
+    // Check a --only-from or --exclude-from pattern, for the options
+    bool valid_glob(const std::string &pattern);
+
+    /* --only-from, --exclude-from and --main-only: whether the decls and
+       macros in a file are output.  Decided by the file a location was
+       expanded in, once per file. */
+    class LocationFilter {
+        clang::SourceManager &_sm;
+        bool _main_only;
+        std::vector<llvm::GlobPattern> _only;
+        std::vector<llvm::GlobPattern> _exclude;
+
+        llvm::DenseMap<clang::FileID, bool> _files;
+
+        bool match(clang::FileID fid) const;
+
+    public:
+        LocationFilter(clang::SourceManager &sm, const config &config);
+
+        // Does config filter anything?
+        static bool active(const config &config);
+
+        bool wanted(clang::SourceLocation loc);
+
+        // Always output what's in fid
+        void allow(clang::FileID fid) { _files[fid] = true; }
+    };
+}
+
+#endif /* C2FFI_FILTER_H */
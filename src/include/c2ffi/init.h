@@ -26,13 +26,24 @@
 #include "c2ffi/opt.h"
 
 namespace c2ffi {
-    void add_include(clang::CompilerInstance &ci, const char *path,
-                     bool isAngled = false, bool show_error = false);
-    void add_includes(clang::CompilerInstance &ci,
+    // Where c's diagnostics and errors go: c.diag, or stderr
+    llvm::raw_ostream& errors(const config &c);
+
+    /* A path that isn't a directory is reported to err, failing, or
+       skipped without it */
+    bool add_include(clang::CompilerInstance &ci, const char *path,
+                     bool isAngled = false, llvm::raw_ostream *err = NULL);
+    bool add_includes(clang::CompilerInstance &ci,
                       c2ffi::IncludeVector &v, bool is_angled = false,
-                      bool show_error = false);
+                      llvm::raw_ostream *err = NULL);
 
-    void init_ci(config &c, clang::CompilerInstance &ci);
+    bool add_include_opts(clang::CompilerInstance &ci,
+                          c2ffi::IncludeVector &v, bool is_angled,
+                          llvm::raw_ostream &err);
+
+    // False, with the reason reported to errors(c), if c can't be used
+    bool init_ci(config &c, clang::CompilerInstance &ci,
+                 clang::FileManager *fm = NULL);
 }
 
 #endif /* C2FFI_INIT_H */
@@ -28,6 +28,11 @@
 namespace c2ffi {
     void process_macros(clang::CompilerInstance &ci, std::ostream &os,
                         const config &config);
+
+    /* Write only the "__c2ffi_NAME = NAME" redefinitions, for parsing
+       back into the same translation unit */
+    void write_macro_redefs(clang::CompilerInstance &ci, std::ostream &os,
+                            const config &config);
 }
 
 #endif /* C2FFI_MACROS_H */
@@ -23,6 +23,7 @@
 #define C2FFI_OPT_H
 
 #include <clang/Frontend/FrontendOptions.h>
+#include <llvm/Support/raw_ostream.h>
 
 #include <vector>
 #include <string>
@@ -32,12 +33,15 @@
 #include "c2ffi.h"
 
 namespace c2ffi {
+    class Stats;
+
     typedef std::vector<std::string> IncludeVector;
 
     struct config {
         IncludeVector includes;
         IncludeVector sys_includes;
         OutputDriver *od = NULL;
+        OutputDriverSpecVector drivers;
 
         std::ostream  *output = NULL;
         std::ofstream *macro_output = NULL;
@@ -46,6 +50,45 @@ namespace c2ffi {
         std::string c2ffi_binpath;
         std::string filename;
         std::string to_namespace;
+        std::string batch_file;
+        std::string serve_socket;
+        std::string emit_pch;
+        std::string include_pch;
+        std::string cache_dir;
+        std::string shard_dir;
+        std::string depfile;
+        IncludeVector dep_targets;
+
+        // Globs for the files whose decls and macros are output
+        IncludeVector only_from;
+        IncludeVector exclude_from;
+        bool main_only = false;
+
+        // --symbols regexes for the decls and macros to output, along
+        // with everything those decls refer to
+        IncludeVector symbols;
+
+        // Main file contents from stdin, for filename
+        std::string input_data;
+        bool read_stdin = false;
+
+        // If set, filled with every file the preprocessor entered
+        IncludeVector *deps = NULL;
+
+        // If set, filled with every directory a header lookup depended
+        // on, so a header added to any of them can be noticed
+        IncludeVector *lookup_dirs = NULL;
+
+        // Where diagnostics and errors go, if not stderr
+        llvm::raw_ostream *diag = NULL;
+
+        // --stats: "text" or "json", and the collector for the current run
+        std::string stats_format;
+        Stats *stats = NULL;
+
+        // --time-trace output, and the shortest event it keeps
+        std::string time_trace;
+        unsigned int time_trace_granularity = 500;
 
         clang::InputKind kind;
         std::string lang;
@@ -54,6 +97,10 @@ namespace c2ffi {
 
         bool preprocess_only = false;
         bool with_macro_defs = false;
+        bool macro_values = false;
+        bool skip_function_bodies = false;
+        bool type_table = false;
+        bool async_output = false;
         bool declspec = false;
         bool fail_on_error = false;
         bool warn_as_error = false;
@@ -62,9 +109,13 @@ namespace c2ffi {
         int wchar_size = 0;
 
         int error_limit = -1;
+
+        // Worker threads for --batch, 0 for one per CPU
+        unsigned int jobs = 1;
     };
 
     void process_args(config &config, int argc, char *argv[]);
+    clang::LangStandard::Kind parseStd(std::string std);
 }
 
 #endif /* C2FFI_OPT_H */
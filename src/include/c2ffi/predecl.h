@@ -35,6 +35,8 @@ namespace c2ffi {
     class DeclType;
     class ReferenceType;
     class TemplateType;
+    class TypeRef;
+    class TypeEntry;
 
     class Decl;
     class UnhandledDecl;
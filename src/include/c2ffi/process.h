@@ -0,0 +1,43 @@
+/*  -*- c++ -*-
+
+    c2ffi
+    Copyright (C) 2013  Ryan Pavlik
+
+    This file is part of c2ffi.
+
+    c2ffi is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    c2ffi is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with c2ffi.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef C2FFI_PROCESS_H
+#define C2FFI_PROCESS_H
+
+#include <clang/Basic/FileManager.h>
+
+#include "c2ffi/opt.h"
+
+namespace c2ffi {
+    /* Run c2ffi over config.filename, writing to config.od.  If fm is
+       given, it is shared with the CompilerInstance so stat and file
+       lookups carry over between calls.  Returns the exit status. */
+    int process_file(config &config, clang::FileManager *fm = NULL);
+
+    /* Run process_file() over every input listed in config.batch_file */
+    int process_batch(config &config);
+
+    /* Answer requests on the Unix socket config.serve_socket until
+       killed, keeping clang's caches warm between requests */
+    int process_serve(config &config);
+}
+
+#endif /* C2FFI_PROCESS_H */
@@ -0,0 +1,163 @@
+/*  -*- c++ -*-
+
+    c2ffi
+    Copyright (C) 2013  Ryan Pavlik
+
+    This file is part of c2ffi.
+
+    c2ffi is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    c2ffi is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with c2ffi.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef C2FFI_SHARD_H
+#define C2FFI_SHARD_H
+
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#include <llvm/ADT/DenseMap.h>
+
+#include <clang/Basic/SourceLocation.h>
+
+#include "c2ffi/opt.h"
+
+namespace clang {
+    class CompilerInstance;
+    class Decl;
+    class FileEntry;
+    class IdentifierInfo;
+    class MacroInfo;
+}
+
+namespace c2ffi {
+    /* The converted output of one top-level decl, and what converting
+       it did to the consumer's state, so both can be replayed */
+    struct ShardEntry {
+        struct Event {
+            char kind;              // 'I': new decl id, 'C': cur decl
+            unsigned int id;
+            std::string decl;
+        };
+
+        std::string decl;
+        unsigned int first_id = 0;  // the last id given before this
+        std::vector<Event> events;
+        std::string text;
+    };
+
+    /* The decls from one inclusion of a header */
+    struct Shard {
+        std::string key;
+        std::string path;
+
+        // Files entered while this one was open, as "HASH PATH"
+        IncludeVector nested;
+        std::vector<ShardEntry> entries;
+
+        // What was found in the cache for key, if anything
+        IncludeVector cached_nested;
+        std::vector<ShardEntry> cached_entries;
+        bool cached = false;
+        bool diverged = false;
+        size_t next = 0;
+    };
+
+    /* --shard-dir: caches the output for each header inclusion.
+
+       The key for an inclusion is taken when it's entered, from the
+       header's path and content, the macros defined at that point, the
+       headers already finished, in order, and the text of each
+       including file up to its #include.  Including files are hashed
+       without their paths, so a header is reused under different main
+       files which start the same way.  Since decls can depend on headers included later by this one,
+       those are checked against the ones recorded in the cache as
+       they're entered; cached output is used up to the first
+       difference.
+
+       Converting a decl assigns ids and marks decls as current; these
+       are recorded with each entry and replayed, keyed by where the
+       decls are, which is the same in any run with the same key.  Ids
+       are only replayed from the same starting point, so an entry is
+       converted again if the including files took a different number
+       of ids before it. */
+    class ShardCache {
+        clang::CompilerInstance &_ci;
+        const config &_config;
+        std::string _config_key;
+
+        std::map<clang::FileID, Shard> _shards;
+
+        struct OpenFile {
+            clang::FileID fid;
+            std::string path;
+            std::string hash;
+            Shard *shard;
+        };
+
+        std::vector<OpenFile> _open;
+        std::string _finished;
+
+        // How many times each file was entered before, by path and FileID
+        std::map<std::string, unsigned int> _entered;
+        llvm::DenseMap<clang::FileID, unsigned int> _inclusions;
+
+        llvm::DenseMap<const clang::FileEntry*, std::string> _file_hashes;
+        llvm::DenseMap<const clang::IdentifierInfo*, uint64_t> _macros;
+        uint64_t _macro_state;
+
+        ShardEntry *_recording;
+        std::map<std::string, unsigned int> _ids;
+        std::set<std::string> _cur;
+
+        std::string shard_path(const std::string &key) const;
+        std::string content_hash(clang::FileID fid);
+        std::string file_key(clang::FileID fid) const;
+        bool load(Shard &shard);
+        Shard* shard_for(const clang::Decl *d);
+
+    public:
+        ShardCache(clang::CompilerInstance &ci, const config &config);
+
+        static bool usable(const config &config);
+
+        // From the preprocessor
+        void enter(clang::FileID fid);
+        void exit(clang::FileID fid);
+        void define(const clang::IdentifierInfo *ii, const clang::MacroInfo *mi);
+        void undefine(const clang::IdentifierInfo *ii);
+
+        // Identifies d the same way in any run with the same shard key
+        std::string decl_key(const clang::Decl *d) const;
+
+        enum Result { UNSHARDED, REPLAYED, RECORDING };
+
+        /* Called for each top-level decl.  If it can be replayed, text
+           is set to its output, and last_id raised to the highest id it
+           assigned.  If RECORDING, call end() with the output once d has
+           been converted. */
+        Result begin(const clang::Decl *d, std::string &text, unsigned int &last_id);
+        void end(const std::string &text);
+
+        void note_id(const clang::Decl *d, unsigned int id);
+        void note_cur(const clang::Decl *d);
+        bool find_id(const clang::Decl *d, unsigned int &id) const;
+        bool find_cur(const clang::Decl *d) const;
+
+        // Write any new or changed shards
+        void save();
+    };
+}
+
+#endif /* C2FFI_SHARD_H */
@@ -0,0 +1,92 @@
+/*  -*- c++ -*-
+
+    c2ffi
+    Copyright (C) 2013  Ryan Pavlik
+
+    This file is part of c2ffi.
+
+    c2ffi is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    c2ffi is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with c2ffi.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef C2FFI_SINK_H
+#define C2FFI_SINK_H
+
+#include <condition_variable>
+#include <iostream>
+#include <mutex>
+#include <streambuf>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace c2ffi {
+    /* std::streambuf writing to a file descriptor with write(2), a large
+       buffer at a time; nothing is written until the buffer fills or
+       sync() is called.  With async, a full buffer is written by a
+       thread of its own while the other one fills, so the caller only
+       waits when the descriptor is a whole buffer behind. */
+    class FdSink : public std::streambuf {
+        int _fd;
+        bool _owned;
+        bool _async;
+        bool _error;
+
+        std::vector<char> _bufs[2];
+        int _cur;
+
+        // With async, the buffer being written, if any, and the thread
+        // writing it; these are shared under _lock
+        std::thread _writer;
+        std::mutex _lock;
+        std::condition_variable _cond;
+        const char *_pending;
+        size_t _pending_size;
+        bool _stop;
+
+        bool write_all(const char *p, size_t n);
+        void run();
+        bool wait();
+        bool drain();
+
+    protected:
+        int_type overflow(int_type c);
+        std::streamsize xsputn(const char *s, std::streamsize n);
+        int sync();
+
+    public:
+        static const size_t BUFFER_SIZE = 1 << 20;
+
+        FdSink(int fd, bool owned, bool async);
+        ~FdSink();
+
+        /* Write everything out and stop the thread, closing the
+           descriptor if it's owned; false if any of it failed */
+        bool close();
+    };
+
+    // std::ostream over its own FdSink
+    class FdStream : public std::ostream {
+        FdSink _sink;
+
+    public:
+        FdStream(int fd, bool owned, bool async);
+
+        // Create or truncate path; NULL, with errno set, on failure
+        static FdStream* open(const std::string &path, bool async);
+
+        bool close();
+    };
+}
+
+#endif /* C2FFI_SINK_H */
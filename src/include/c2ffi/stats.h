@@ -0,0 +1,123 @@
+/*  -*- c++ -*-
+
+    c2ffi
+    Copyright (C) 2013  Ryan Pavlik
+
+    This file is part of c2ffi.
+
+    c2ffi is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    c2ffi is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with c2ffi.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef C2FFI_STATS_H
+#define C2FFI_STATS_H
+
+#include <cstdint>
+#include <iostream>
+#include <streambuf>
+#include <string>
+
+#include <llvm/ADT/StringMap.h>
+#include <llvm/ADT/StringRef.h>
+
+#include "c2ffi/opt.h"
+
+namespace c2ffi {
+    /* --stats: where one run of process_file() spent its time and
+       memory, reported on stderr when it's destroyed */
+    class Stats {
+    public:
+        enum Phase { INIT, PREPROCESS, PARSE, CONVERT, WRITE, MACROS, NPHASES };
+
+        struct Time {
+            double wall = 0;
+            double cpu = 0;
+        };
+
+        static Time now();
+
+        Stats(config &config);
+        ~Stats();
+
+        Time phases[NPHASES];
+
+        // Set once the AST is complete
+        size_t ast_bytes = 0;
+
+        void count_decl(llvm::StringRef kind) { ++_decls[kind]; }
+        void count_type(llvm::StringRef kind) { ++_types[kind]; }
+
+        // A make_type() call, and whether the TypeCache had it
+        void count_type_lookup(bool hit) {
+            ++_type_lookups;
+            if(hit) ++_type_hits;
+        }
+
+    private:
+        // Passes writes through to another streambuf, counting them
+        class CountingBuf : public std::streambuf {
+            std::streambuf *_buf;
+            uint64_t &_count;
+
+        protected:
+            int_type overflow(int_type c);
+            std::streamsize xsputn(const char *s, std::streamsize n);
+            int sync();
+
+        public:
+            CountingBuf(std::streambuf *buf, uint64_t &count)
+                : _buf(buf), _count(count) { }
+        };
+
+        config &_config;
+        Time _start;
+
+        llvm::StringMap<unsigned long> _decls;
+        llvm::StringMap<unsigned long> _types;
+        unsigned long _type_lookups = 0;
+        unsigned long _type_hits = 0;
+
+        static const int NSTREAMS = 3;
+        std::ostream *_streams[NSTREAMS];
+        std::streambuf *_saved[NSTREAMS];
+        CountingBuf *_bufs[NSTREAMS];
+        uint64_t _output_bytes;
+
+        void print_text(std::ostream &os, const Time &total, long rss) const;
+        void print_json(std::ostream &os, const Time &total, long rss) const;
+    };
+
+    /* Charges the time until it's destroyed to one phase.  Timers nest
+       per thread: while an inner one runs, the outer one is paused, so
+       every phase only counts its own time.  Does nothing without
+       stats. */
+    class StatsTimer {
+        Stats *_stats;
+        Stats::Phase _phase;
+        StatsTimer *_outer;
+        Stats::Time _start;
+
+        static thread_local StatsTimer *_current;
+
+        void charge(const Stats::Time &now);
+
+    public:
+        StatsTimer(Stats *stats, Stats::Phase phase);
+        ~StatsTimer() { stop(); }
+
+        // End the phase early
+        void stop();
+    };
+}
+
+#endif /* C2FFI_STATS_H */
@@ -0,0 +1,95 @@
+/*  -*- c++ -*-
+
+    c2ffi
+    Copyright (C) 2013  Ryan Pavlik
+
+    This file is part of c2ffi.
+
+    c2ffi is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    c2ffi is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with c2ffi.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef C2FFI_SYMBOLS_H
+#define C2FFI_SYMBOLS_H
+
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+#include <llvm/ADT/StringRef.h>
+#include <llvm/Support/Regex.h>
+
+#include <clang/AST/Type.h>
+
+#include "c2ffi/opt.h"
+
+namespace clang {
+    class Decl;
+    class DeclContext;
+    class ObjCContainerDecl;
+}
+
+namespace c2ffi {
+    /* Read --symbols ARG into patterns: the lines of ARG if it's a file,
+       otherwise ARG itself.  Returns false, with an error message, if
+       a pattern isn't a valid regex. */
+    bool add_symbol_patterns(IncludeVector &patterns, const std::string &arg,
+                             std::string &error);
+
+    /* --symbols: only output the decls whose names match, and every decl
+       their signatures, fields and typedefs refer to, however
+       indirectly.
+
+       Since a decl can refer to one parsed after it, top-level decls
+       are collected with add() and only output once close() has found
+       what's reachable, in their original order. */
+    class SymbolSet {
+        std::vector<std::unique_ptr<llvm::Regex> > _patterns;
+
+        std::vector<clang::Decl*> _decls;
+        std::set<const clang::Decl*> _forced;
+
+        // Canonical decls, and the namespaces etc. containing them
+        std::set<const clang::Decl*> _wanted;
+        std::set<const clang::Decl*> _contexts;
+        std::vector<const clang::Decl*> _work;
+
+        void find_roots(const clang::Decl *d);
+        void mark(const clang::Decl *d);
+        void mark_contexts(const clang::Decl *d);
+        void walk(const clang::Decl *d);
+        void walk_container(const clang::ObjCContainerDecl *c);
+        void walk_type(clang::QualType qt);
+
+    public:
+        SymbolSet(const config &config);
+
+        static bool active(const config &config) { return !config.symbols.empty(); }
+
+        // Does a decl or macro name match one of the patterns?
+        bool matches(llvm::StringRef name) const;
+
+        // Collect a top-level decl; forced decls are always output
+        void add(clang::Decl *d, bool forced = false);
+
+        void close();
+
+        // After close(), the top-level decls in order
+        const std::vector<clang::Decl*>& decls() const { return _decls; }
+
+        bool wanted(const clang::Decl *d) const;
+    };
+}
+
+#endif /* C2FFI_SYMBOLS_H */
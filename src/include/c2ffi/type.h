@@ -25,6 +25,7 @@
 #include <string>
 #include <vector>
 #include <ostream>
+#include <unordered_map>
 
 #include <stdint.h>
 
@@ -43,7 +44,6 @@ namespace c2ffi {
         const clang::CompilerInstance &_ci;
         const clang::Type *_type;
 
-        uint64_t _bit_offset;
         uint64_t _bit_size;
         unsigned _bit_alignment;
 
@@ -53,13 +53,19 @@ namespace c2ffi {
         virtual ~Type() { }
 
         static Type* make_type(C2FFIASTConsumer*, const clang::Type*);
+        static Type* convert(C2FFIASTConsumer*, const clang::Type*);
+
+        // The type of a field, with its bitfield width (0 if it isn't one)
+        static Type* make_field_type(C2FFIASTConsumer*, const clang::Type*,
+                                     unsigned width);
+
+        // Can this be shared: is it the same for every use of its
+        // clang type from now on?
+        virtual bool shareable() const { return true; }
 
         unsigned int id() const { return _id; }
         void set_id(unsigned int id) { _id = id; }
 
-        uint64_t bit_offset() const { return _bit_offset; }
-        void set_bit_offset(uint64_t offset) { _bit_offset = offset; }
-
         uint64_t bit_size() const { return _bit_size; }
         void set_bit_size(uint64_t size) { _bit_size = size; }
 
@@ -67,12 +73,24 @@ namespace c2ffi {
         void set_bit_alignment(uint64_t alignment) { _bit_alignment = alignment; }
 
         std::string metatype() const;
+
+        // Is this a TypeRef?
+        virtual bool is_ref() const { return false; }
     };
 
     typedef std::string Name;
     typedef std::vector<Name> NameVector;
 
-    typedef std::pair<Name, Type*> NameTypePair;
+    // A field or parameter; record fields also have their layout here,
+    // as their Type may be shared
+    struct NameTypePair : public std::pair<Name, Type*> {
+        uint64_t bit_offset = 0;
+        uint64_t bit_size = 0;
+        unsigned bit_alignment = 0;
+
+        NameTypePair(Name name, Type *t) : std::pair<Name, Type*>(name, t) { }
+    };
+
     typedef std::vector<NameTypePair> NameTypeVector;
 
     typedef std::pair<Name, uint64_t> NameNumPair;
@@ -107,11 +125,12 @@ namespace c2ffi {
                      unsigned int width, Type *base)
             : Type(ci, t), _base(base), _width(width) { }
 
-        virtual ~BitfieldType() { delete _base; }
 
         const Type* base() const { return _base; }
         unsigned int width() const { return _width; }
 
+        virtual bool shareable() const { return _base->shareable(); }
+
         DEFWRITER(BitfieldType);
     };
 
@@ -123,11 +142,12 @@ namespace c2ffi {
         PointerType(const clang::CompilerInstance &ci, const clang::Type *t,
                     Type *pointee)
             : Type(ci, t), _pointee(pointee) { }
-        virtual ~PointerType() { delete _pointee; }
 
         const Type& pointee() const { return *_pointee; }
         bool is_string() const;
 
+        virtual bool shareable() const { return _pointee->shareable(); }
+
         DEFWRITER(PointerType);
     };
 
@@ -170,6 +190,10 @@ namespace c2ffi {
         EnumType(const clang::CompilerInstance &ci, const clang::Type *t,
                  std::string name)
             : SimpleType(ci, t, name) { }
+
+        // Anonymous enums are only known by an id, once they have one
+        virtual bool shareable() const { return !name().empty() || id(); }
+
         DEFWRITER(EnumType);
     };
 
@@ -179,11 +203,12 @@ namespace c2ffi {
         ComplexType(const clang::CompilerInstance &ci, const clang::Type *t,
                     Type *element)
             : Type(ci, t), _element(element) { }
-        virtual ~ComplexType() { delete _element; }
 
         const Type& element() const { return *_element; }
         bool is_string() const;
 
+        virtual bool shareable() const { return _element->shareable(); }
+
         DEFWRITER(ComplexType);
     };
 
@@ -197,6 +222,72 @@ namespace c2ffi {
 
         // Note, this cheats:
         virtual void write(OutputDriver &od) const;
+
+        // Only the first use of an inline definition includes it
+        virtual bool shareable() const { return false; }
+    };
+
+    // --type-table: a use of the type in table entry id()
+    class TypeRef : public Type {
+    public:
+        TypeRef(const clang::CompilerInstance &ci, const clang::Type *t,
+                unsigned int id)
+            : Type(ci, t) { set_id(id); }
+
+        virtual bool is_ref() const { return true; }
+
+        DEFWRITER(TypeRef);
+    };
+
+    // A type in the table, written as its own top-level entry
+    class TypeEntry : public Writable {
+        unsigned int _id;
+        Type *_type;
+    public:
+        TypeEntry(unsigned int id, Type *type)
+            : _id(id), _type(type) { }
+
+        unsigned int id() const { return _id; }
+        const Type& type() const { return *_type; }
+
+        DEFWRITER(TypeEntry);
+    };
+
+    /* With --type-table, make_type() converts each distinct clang type
+       only once, into an entry in this table, and returns a TypeRef to
+       it.  Types are keyed as written, sugar and all, since typedef
+       names are part of the output.  Entries are written ahead of the
+       first decl using them, so every id is defined before it's
+       referenced. */
+    class TypeTable {
+        typedef std::unordered_map<const clang::Type*, unsigned int> TypeIDMap;
+
+        TypeIDMap _ids;
+        unsigned int _last_id;
+        std::vector<TypeEntry*> _pending;
+
+    public:
+        TypeTable() : _last_id(0) { }
+
+        Type* intern(C2FFIASTConsumer *ast, const clang::Type *t);
+
+        // Write the entries added since the last call, as decls
+        void write_pending(OutputDriver &od, bool &mid);
+    };
+
+    /* Every use of a clang type converts to the same thing, once its
+       decl has been seen, so make_type() keeps each shareable() result
+       here and returns it again, rather than building a new tree for
+       every use.  Shared types are never changed once they're here. */
+    class TypeCache {
+        typedef std::unordered_map<const clang::Type*, Type*> TypeMap;
+
+        TypeMap _types;
+
+    public:
+
+        Type* find(const clang::Type *t) const;
+        void add(const clang::Type *t, Type *type);
     };
 }
 
@@ -19,11 +19,16 @@
 */
 
 #include <iostream>
+#include <map>
 #include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
 
 #include <llvm/TargetParser/Host.h>
 #include <llvm/ADT/IntrusiveRefCntPtr.h>
 #include <llvm/Option/Option.h>
+#include <llvm/Support/Path.h>
 
 #include <clang/Driver/Driver.h>
 #include <clang/Driver/Compilation.h>
@@ -54,22 +59,21 @@
 
 using namespace c2ffi;
 
-void c2ffi::add_include(clang::CompilerInstance &ci, const char *path, bool is_angled,
-                        bool show_error) {
+llvm::raw_ostream& c2ffi::errors(const config &c) {
+    return c.diag ? *c.diag : llvm::errs();
+}
+
+bool c2ffi::add_include(clang::CompilerInstance &ci, const char *path, bool is_angled,
+                        llvm::raw_ostream *err) {
     struct stat buf{};
     if(stat(path, &buf) < 0 || !S_ISDIR(buf.st_mode)) {
-        if(show_error) {
-            std::cerr << "Error: Not a directory: ";
-            if(is_angled)
-                std::cerr << "-i ";
-            else
-                std::cerr << "-I ";
-
-            std::cerr << path << std::endl;
-            exit(1);
+        if(err) {
+            *err << "Error: Not a directory: " << (is_angled ? "-i " : "-I ")
+                 << path << "\n";
+            return false;
         }
 
-        return;
+        return true;
     }
 
     auto &fm = ci.getFileManager();
@@ -79,16 +83,101 @@ void c2ffi::add_include(clang::CompilerInstance &ci, const char *path, bool is_a
         ci.getPreprocessor().getHeaderSearchInfo()
             .AddSearchPath(lookup, is_angled);
     }
+
+    return true;
 }
 
-void c2ffi::add_includes(clang::CompilerInstance &ci,
+bool c2ffi::add_includes(clang::CompilerInstance &ci,
                          c2ffi::IncludeVector &includeVector, bool is_angled,
-                         bool show_error) {
+                         llvm::raw_ostream *err) {
     for(auto &&include : includeVector)
-        add_include(ci, include.c_str(), is_angled, show_error);
+        if(!add_include(ci, include.c_str(), is_angled, err))
+            return false;
+
+    return true;
+}
+
+// Like add_includes(), but for when the Preprocessor will be recreated
+// from the invocation, e.g. by a FrontendAction
+bool c2ffi::add_include_opts(clang::CompilerInstance &ci,
+                             c2ffi::IncludeVector &includeVector, bool is_angled,
+                             llvm::raw_ostream &err) {
+    for(auto &&include : includeVector) {
+        struct stat buf{};
+        if(stat(include.c_str(), &buf) < 0 || !S_ISDIR(buf.st_mode)) {
+            err << "Error: Not a directory: " << (is_angled ? "-i " : "-I ")
+                << include << "\n";
+            return false;
+        }
+
+        ci.getHeaderSearchOpts().AddPath(include,
+                                         is_angled ? clang::frontend::Angled : clang::frontend::Quoted,
+                                         false, true);
+    }
+
+    return true;
+}
+
+namespace {
+    // The -cc1 arguments the driver produced for an input, so later
+    // inputs of the same kind can skip toolchain detection entirely.
+    struct ResolvedArgs {
+        std::vector<std::string> args;
+        size_t input;
+        size_t main_file_name;
+    };
+
+    typedef std::map<std::string, ResolvedArgs> ResolvedArgsMap;
+}
+
+static ResolvedArgsMap resolved_args;
+static std::mutex      resolved_args_mutex;
+
+static std::string resolved_args_key(const config &c) {
+    std::string key = c.arch;
+    key += '\0';
+    key += c.lang;
+    key += '\0';
+    key += c.nostdinc ? "1" : "0";
+    key += '\0';
+    key += llvm::sys::path::extension(c.filename).str();
+    return key;
+}
+
+static bool find_resolved_args(const config &c, std::vector<std::string> &args) {
+    std::lock_guard<std::mutex> lock(resolved_args_mutex);
+    ResolvedArgsMap::iterator it = resolved_args.find(resolved_args_key(c));
+    if(it == resolved_args.end())
+        return false;
+
+    args = it->second.args;
+    args[it->second.input] = c.filename;
+    if(it->second.main_file_name)
+        args[it->second.main_file_name] = llvm::sys::path::filename(c.filename).str();
+
+    return true;
 }
 
-void c2ffi::init_ci(config &c, clang::CompilerInstance &ci) {
+static void save_resolved_args(const config &c, const std::vector<std::string> &args) {
+    ResolvedArgs r;
+    r.args = args;
+    r.input = args.size();
+    r.main_file_name = 0;
+
+    for(size_t i = 0; i < args.size(); i++) {
+        if(args[i] == c.filename)
+            r.input = i;
+        else if(args[i] == "-main-file-name" && i + 1 < args.size())
+            r.main_file_name = i + 1;
+    }
+
+    if(r.input < args.size()) {
+        std::lock_guard<std::mutex> lock(resolved_args_mutex);
+        resolved_args[resolved_args_key(c)] = r;
+    }
+}
+
+bool c2ffi::init_ci(config &c, clang::CompilerInstance &ci, clang::FileManager *fm) {
     using clang::DiagnosticOptions;
     using clang::TextDiagnosticPrinter;
     using clang::TargetOptions;
@@ -96,48 +185,61 @@ void c2ffi::init_ci(config &c, clang::CompilerInstance &ci) {
     using clang::IntrusiveRefCntPtr;
     using clang::CompilerInvocation;
 
-    std::vector<const char *> cargs;
-    cargs.push_back(c.c2ffi_binpath.c_str());
-    cargs.push_back("-fsyntax-only");
-    cargs.push_back("-resource-dir");
-    cargs.push_back(CLANG_RESOURCE_DIRECTORY);
-    if (c.nostdinc) {
-        cargs.push_back("-nostdinc");
-    }
-    if (!c.lang.empty()) {
-        cargs.push_back("-x");
-        cargs.push_back(c.lang.c_str());
-    }
-    cargs.push_back(c.filename.c_str());
-
     IntrusiveRefCntPtr<DiagnosticOptions> DiagOpts = new DiagnosticOptions();
     TextDiagnosticPrinter *tpd =
-        new TextDiagnosticPrinter(llvm::errs(), &*DiagOpts, false);
+        new TextDiagnosticPrinter(errors(c), &*DiagOpts, false);
     IntrusiveRefCntPtr<clang::DiagnosticIDs> DiagID(
         new clang::DiagnosticIDs());
     clang::DiagnosticsEngine Diags(DiagID, &*DiagOpts, tpd);
 
-    clang::driver::Driver Driver(
-        c.c2ffi_binpath,
-        c.arch.empty() ? llvm::sys::getDefaultTargetTriple() : c.arch, Diags);
-    Driver.setCheckInputsExist(false);
+    std::vector<std::string> cc1args;
 
-    std::unique_ptr<clang::driver::Compilation> C(Driver.BuildCompilation(cargs));
-    const clang::driver::JobList &Jobs = C->getJobs();
-    if (Jobs.size() != 1) {
-        Diags.Report(clang::diag::err_fe_expected_compiler_job);
-        exit(1);
-    }
+    if(!find_resolved_args(c, cc1args)) {
+        std::vector<const char *> cargs;
+        cargs.push_back(c.c2ffi_binpath.c_str());
+        cargs.push_back("-fsyntax-only");
+        cargs.push_back("-resource-dir");
+        cargs.push_back(CLANG_RESOURCE_DIRECTORY);
+        if (c.nostdinc) {
+            cargs.push_back("-nostdinc");
+        }
+        if (!c.lang.empty()) {
+            cargs.push_back("-x");
+            cargs.push_back(c.lang.c_str());
+        }
+        cargs.push_back(c.filename.c_str());
+
+        clang::driver::Driver Driver(
+            c.c2ffi_binpath,
+            c.arch.empty() ? llvm::sys::getDefaultTargetTriple() : c.arch, Diags);
+        Driver.setCheckInputsExist(false);
+
+        std::unique_ptr<clang::driver::Compilation> C(Driver.BuildCompilation(cargs));
+        const clang::driver::JobList &Jobs = C->getJobs();
+        if (Jobs.size() != 1) {
+            Diags.Report(clang::diag::err_fe_expected_compiler_job);
+            return false;
+        }
+
+        const clang::driver::Command &Cmd = clang::cast<clang::driver::Command>(*Jobs.begin());
+        if (llvm::StringRef(Cmd.getCreator().getName()) != "clang") {
+            Diags.Report(clang::diag::err_fe_expected_clang_command);
+            return false;
+        }
 
-    const clang::driver::Command &Cmd = clang::cast<clang::driver::Command>(*Jobs.begin());
-    if (llvm::StringRef(Cmd.getCreator().getName()) != "clang") {
-        Diags.Report(clang::diag::err_fe_expected_clang_command);
-        exit(1);
+        for(const char *arg : Cmd.getArguments())
+            cc1args.push_back(arg);
+
+        save_resolved_args(c, cc1args);
     }
 
-    static std::unique_ptr<clang::CompilerInvocation> cinv;
-    cinv = std::make_unique<CompilerInvocation>();
-    CompilerInvocation::CreateFromArgs(*cinv, Cmd.getArguments(), Diags);
+    std::vector<const char *> cc1argv;
+    for(const std::string &arg : cc1args)
+        cc1argv.push_back(arg.c_str());
+
+    std::unique_ptr<clang::CompilerInvocation> cinv =
+        std::make_unique<CompilerInvocation>();
+    CompilerInvocation::CreateFromArgs(*cinv, cc1argv, Diags);
     if (c.nostdinc) {
         // setting -nostdinc isn't sufficient for some reason, this erases all
         // the search paths that were added previously.
@@ -149,8 +251,8 @@ void c2ffi::init_ci(config &c, clang::CompilerInstance &ci) {
     // Extract the language that was inferred or specified for the input file.
     auto &fInputs = ci.getInvocation().getFrontendOpts().Inputs;
     if (fInputs.size() != 1) {
-        std::cout << "Error: No input files from frontend" << std::endl;
-        exit(1);
+        errors(c) << "Error: No input files from frontend\n";
+        return false;
     } else {
         c.kind = fInputs[0].getKind();
         switch (c.kind.getLanguage()) {
@@ -160,20 +262,26 @@ void c2ffi::init_ci(config &c, clang::CompilerInstance &ci) {
         case clang::Language::ObjCXX:
             break;
         default:
-            std::cerr << "Error: Language " << (c.lang.empty() ? "of file " + c.filename : c.lang)
-                      << " not supported." << std::endl;
-            exit(1);
+            errors(c) << "Error: Language " << (c.lang.empty() ? "of file " + c.filename : c.lang)
+                      << " not supported.\n";
+            return false;
         }
     }
 
+    // c2ffi only reads signatures.  Sema still parses constexpr bodies
+    // and those with deduced return types, so their values are known.
+    ci.getFrontendOpts().SkipFunctionBodies = c.skip_function_bodies;
+
     // Create the compilers actual diagnostics engine.
-    ci.createDiagnostics();
+    ci.createDiagnostics(c.diag ? new TextDiagnosticPrinter(*c.diag, &ci.getDiagnosticOpts()) : NULL);
     ci.getDiagnostics().setWarningsAsErrors(c.warn_as_error);
     if (c.error_limit >= 0)
       ci.getDiagnostics().setErrorLimit(c.error_limit);
 
     TargetInfo *pti = TargetInfo::CreateTargetInfo(
         ci.getDiagnostics(), ci.getInvocation().TargetOpts);
+    if(!pti)
+        return false;
     ci.setTarget(pti);
 
     clang::LangOptions &lo = ci.getLangOpts();
@@ -186,10 +294,10 @@ void c2ffi::init_ci(config &c, clang::CompilerInstance &ci) {
             lo.MicrosoftExt = 1;
             break;
         default:
-            std::cerr << "c2ffi warning: Unhandled environment: '"
-                      << pti->getTriple().getEnvironmentName().str()
+            errors(c) << "c2ffi warning: Unhandled environment: '"
+                      << pti->getTriple().getEnvironmentName()
                       << "' for triple '" << c.arch
-                      << "'" << std::endl;
+                      << "'\n";
     }
 
     if(c.declspec)
@@ -202,7 +310,10 @@ void c2ffi::init_ci(config &c, clang::CompilerInstance &ci) {
     ci.getInvocation().getLangOpts()->setLangDefaults(lo, c.kind.getLanguage(),
                                                       pti->getTriple(), includes, c.std);
     //clang::LangOptions::setLangDefaults(lo, c.kind.getLanguage(), pti->getTriple(), includes, c.std);
-    ci.createFileManager();
+    if(fm)
+        ci.setFileManager(fm);
+    else
+        ci.createFileManager();
     ci.createSourceManager(ci.getFileManager());
 
     // examples/clang-interpreter/main.cpp
@@ -210,6 +321,8 @@ void c2ffi::init_ci(config &c, clang::CompilerInstance &ci) {
     clang::HeaderSearchOptions &hso = ci.getHeaderSearchOpts();
     if (!c.nostdinc && hso.ResourceDir.empty())
         hso.ResourceDir = CLANG_RESOURCE_DIRECTORY;
+    if (!c.include_pch.empty())
+        ci.getPreprocessorOpts().ImplicitPCHInclude = c.include_pch;
     ci.createPreprocessor(clang::TU_Complete);
     ci.getPreprocessorOpts().UsePredefines = false;
     ci.getPreprocessorOutputOpts().ShowCPP = c.preprocess_only;
@@ -217,4 +330,6 @@ void c2ffi::init_ci(config &c, clang::CompilerInstance &ci) {
     PP.setPreprocessedOutput(c.preprocess_only);
     // FIXME this is normally called from FrontendAction. Perhaps we should use IndexAction?
     PP.getBuiltinInfo().initializeBuiltins(PP.getIdentifierTable(), PP.getLangOpts());
+
+    return true;
 }
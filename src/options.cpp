@@ -21,15 +21,21 @@
 
 #include <limits.h>
 
+#include <sstream>
+
 #include <getopt.h>
 #include <sys/stat.h>
+#include <unistd.h>
 
 #include <llvm/TargetParser/Host.h>
 
 #include "c2ffi.h"
+#include "c2ffi/filter.h"
 #include "c2ffi/opt.h"
+#include "c2ffi/sink.h"
+#include "c2ffi/symbols.h"
 
-static char short_opt[] = "I:i:D:M:o:hN:x:A:T:E";
+static char short_opt[] = "I:i:D:M:o:hN:x:A:T:Ej:";
 
 enum {
     WITH_MACRO_DEFS = CHAR_MAX+1,
@@ -39,6 +45,26 @@ enum {
     NOSTDINC        = CHAR_MAX+5,
     WCHAR_SIZE      = CHAR_MAX+6,
     ERROR_LIMIT     = CHAR_MAX+7,
+    BATCH           = CHAR_MAX+8,
+    SERVE           = CHAR_MAX+9,
+    EMIT_PCH        = CHAR_MAX+10,
+    INCLUDE_PCH     = CHAR_MAX+11,
+    MACRO_VALUES    = CHAR_MAX+12,
+    CACHE_DIR       = CHAR_MAX+13,
+    DEPFILE         = CHAR_MAX+14,
+    DEP_TARGET      = CHAR_MAX+15,
+    SHARD_DIR       = CHAR_MAX+16,
+    STDIN_NAME      = CHAR_MAX+17,
+    STATS           = CHAR_MAX+18,
+    TIME_TRACE      = CHAR_MAX+19,
+    TIME_TRACE_GRANULARITY = CHAR_MAX+20,
+    ONLY_FROM       = CHAR_MAX+21,
+    EXCLUDE_FROM    = CHAR_MAX+22,
+    MAIN_ONLY       = CHAR_MAX+23,
+    SKIP_FUNCTION_BODIES = CHAR_MAX+24,
+    SYMBOLS         = CHAR_MAX+25,
+    TYPE_TABLE      = CHAR_MAX+26,
+    ASYNC_OUTPUT    = CHAR_MAX+27,
 
     OPTION_MAX
 };
@@ -55,6 +81,7 @@ static struct option options[] = {
     { "arch",        required_argument, 0, 'A' },
     { "templates",   required_argument, 0, 'T' },
     { "std",         required_argument, 0, 'S' },
+    { "jobs",        required_argument, 0, 'j' },
     { "with-macro-defs", no_argument,   0, WITH_MACRO_DEFS },
     { "declspec",        no_argument,   0, DECLSPEC        },
     { "fail-on-error",   no_argument,   0, FAIL_ON_ERROR   },
@@ -62,13 +89,33 @@ static struct option options[] = {
     { "nostdinc",        no_argument,   0, NOSTDINC        },
     { "wchar-size",  required_argument, 0, WCHAR_SIZE      },
     { "error-limit", required_argument, 0, ERROR_LIMIT     },
+    { "batch",       required_argument, 0, BATCH           },
+    { "serve",       required_argument, 0, SERVE           },
+    { "emit-pch",    required_argument, 0, EMIT_PCH        },
+    { "include-pch", required_argument, 0, INCLUDE_PCH     },
+    { "macro-values",    no_argument,   0, MACRO_VALUES    },
+    { "cache-dir",   required_argument, 0, CACHE_DIR       },
+    { "depfile",     required_argument, 0, DEPFILE         },
+    { "dep-target",  required_argument, 0, DEP_TARGET      },
+    { "shard-dir",   required_argument, 0, SHARD_DIR       },
+    { "stdin-name",  required_argument, 0, STDIN_NAME      },
+    { "stats",       optional_argument, 0, STATS           },
+    { "time-trace",  required_argument, 0, TIME_TRACE      },
+    { "time-trace-granularity", required_argument, 0, TIME_TRACE_GRANULARITY },
+    { "only-from",   required_argument, 0, ONLY_FROM       },
+    { "exclude-from", required_argument, 0, EXCLUDE_FROM   },
+    { "main-only",       no_argument,   0, MAIN_ONLY       },
+    { "skip-function-bodies", no_argument, 0, SKIP_FUNCTION_BODIES },
+    { "symbols",     required_argument, 0, SYMBOLS         },
+    { "type-table",      no_argument,   0, TYPE_TABLE      },
+    { "async-output",    no_argument,   0, ASYNC_OUTPUT    },
     { 0, 0, 0, 0 }
 };
 
 static void usage(void);
-static c2ffi::OutputDriver* select_driver(std::string name, std::ostream *os);
+static const c2ffi::OutputDriverField* select_driver(std::string name);
 
-clang::LangStandard::Kind parseStd(std::string std) {
+clang::LangStandard::Kind c2ffi::parseStd(std::string std) {
 #define LANGSTANDARD(ident, name, lang, desc, features) if(std == name) return clang::LangStandard::lang_##ident;
 #include "clang/Basic/LangStandards.def"
     return clang::LangStandard::lang_unspecified;
@@ -77,7 +124,9 @@ clang::LangStandard::Kind parseStd(std::string std) {
 void c2ffi::process_args(config &config, int argc, char *argv[]) {
     int o, index;
     bool output_specified = false;
-    std::ostream *os = &std::cout;
+    std::string output_path;
+    std::ostream *os;
+    IncludeVector outputs;
     config.c2ffi_binpath = argv[0];
 
     for(;;) {
@@ -97,6 +146,7 @@ void c2ffi::process_args(config &config, int argc, char *argv[]) {
                 std::ofstream *of = new std::ofstream;
                 of->open(optarg);
                 config.macro_output = of;
+                outputs.push_back(optarg);
                 break;
             }
 
@@ -107,10 +157,9 @@ void c2ffi::process_args(config &config, int argc, char *argv[]) {
                     exit(1);
                 }
 
-                std::ofstream *of = new std::ofstream;
-                of->open(optarg);
-                os = of;
+                output_path = optarg;
                 output_specified = true;
+                outputs.push_back(optarg);
                 break;
             }
 
@@ -122,14 +171,28 @@ void c2ffi::process_args(config &config, int argc, char *argv[]) {
                 config.sys_includes.push_back(optarg);
                 break;
 
-            case 'D':
-                if(config.od) {
-                    std::cerr << "Error: you may only specify one output driver"
-                              << std::endl;
-                    exit(1);
+            case 'D': {
+                std::string arg = optarg;
+                std::string::size_type colon = arg.find(':');
+                OutputDriverSpec spec;
+
+                spec.driver = select_driver(arg.substr(0, colon));
+                if(colon != std::string::npos)
+                    spec.path = arg.substr(colon + 1);
+
+                for(size_t i = 0; spec.path.empty() && i < config.drivers.size(); i++) {
+                    if(config.drivers[i].path.empty()) {
+                        std::cerr << "Error: only one output driver may write to"
+                                  << " the main output; use -D driver:path"
+                                  << std::endl;
+                        exit(1);
+                    }
                 }
-                config.od = select_driver(optarg, os);
+
+                config.drivers.push_back(spec);
+                if(!spec.path.empty()) outputs.push_back(spec.path);
                 break;
+            }
 
             case 'N':
                 config.to_namespace = optarg;
@@ -152,6 +215,7 @@ void c2ffi::process_args(config &config, int argc, char *argv[]) {
 
                 config.template_output = new std::ofstream;
                 config.template_output->open(optarg);
+                outputs.push_back(optarg);
                 break;
 
             case 'E':
@@ -167,10 +231,26 @@ void c2ffi::process_args(config &config, int argc, char *argv[]) {
                 }
                 break;
 
+            case 'j': {
+                int jobs;
+                char term;
+                if(sscanf(optarg, "%d%c", &jobs, &term) != 1 || jobs < 0) {
+                    std::cerr << "Error: jobs must be a valid non-negative integer, -j "
+                              << optarg << std::endl;
+                    exit(1);
+                }
+                config.jobs = jobs;
+                break;
+            }
+
             case WITH_MACRO_DEFS:
                 config.with_macro_defs = true;
                 break;
 
+            case MACRO_VALUES:
+                config.macro_values = true;
+                break;
+
             case DECLSPEC:
                 config.declspec = true;
                 break;
@@ -215,6 +295,109 @@ void c2ffi::process_args(config &config, int argc, char *argv[]) {
                 config.error_limit = error_limit;
                 break;
 
+            case BATCH:
+                config.batch_file = optarg;
+                break;
+
+            case SERVE:
+                config.serve_socket = optarg;
+                break;
+
+            case EMIT_PCH:
+                config.emit_pch = optarg;
+                break;
+
+            case INCLUDE_PCH:
+                config.include_pch = optarg;
+                break;
+
+            case CACHE_DIR:
+                config.cache_dir = optarg;
+                break;
+
+            case DEPFILE:
+                config.depfile = optarg;
+                break;
+
+            case DEP_TARGET:
+                config.dep_targets.push_back(optarg);
+                break;
+
+            case SHARD_DIR:
+                config.shard_dir = optarg;
+                break;
+
+            case STDIN_NAME:
+                config.filename = optarg;
+                config.read_stdin = true;
+                break;
+
+            case STATS:
+                config.stats_format = optarg ? optarg : "text";
+
+                if(config.stats_format != "text" && config.stats_format != "json") {
+                    std::cerr << "Error: --stats must be text or json" << std::endl;
+                    exit(1);
+                }
+                break;
+
+            case TIME_TRACE:
+                config.time_trace = optarg;
+                break;
+
+            case TIME_TRACE_GRANULARITY: {
+                unsigned int granularity;
+                char term;
+
+                if(sscanf(optarg, "%u%c", &granularity, &term) != 1) {
+                    std::cerr << "Error: --time-trace-granularity must be a number of microseconds"
+                              << std::endl;
+                    exit(1);
+                }
+
+                config.time_trace_granularity = granularity;
+                break;
+            }
+
+            case ONLY_FROM:
+            case EXCLUDE_FROM:
+                if(!valid_glob(optarg)) {
+                    std::cerr << "Error: Invalid pattern: " << optarg << std::endl;
+                    exit(1);
+                }
+
+                if(o == ONLY_FROM)
+                    config.only_from.push_back(optarg);
+                else
+                    config.exclude_from.push_back(optarg);
+                break;
+
+            case MAIN_ONLY:
+                config.main_only = true;
+                break;
+
+            case SKIP_FUNCTION_BODIES:
+                config.skip_function_bodies = true;
+                break;
+
+            case SYMBOLS: {
+                std::string error;
+
+                if(!c2ffi::add_symbol_patterns(config.symbols, optarg, error)) {
+                    std::cerr << "Error: Invalid --symbols pattern: " << error << std::endl;
+                    exit(1);
+                }
+                break;
+            }
+
+            case TYPE_TABLE:
+                config.type_table = true;
+                break;
+
+            case ASYNC_OUTPUT:
+                config.async_output = true;
+                break;
+
             case 'h':
                 usage();
                 exit(0);
@@ -226,7 +409,99 @@ void c2ffi::process_args(config &config, int argc, char *argv[]) {
         }
     }
 
-    if(optind >= argc) {
+    if(config.drivers.empty()) {
+        OutputDriverSpec spec;
+        spec.driver = &OutputDrivers[0];
+        config.drivers.push_back(spec);
+    }
+
+    if(!config.shard_dir.empty() &&
+       (config.template_output || config.drivers.size() > 1 || !config.drivers[0].path.empty())) {
+        std::cerr << "Error: --shard-dir may not be used with -T or -D DRIVER:PATH"
+                  << std::endl;
+        exit(1);
+    }
+
+    if(!config.shard_dir.empty() && config.drivers[0].driver->stateful) {
+        std::cerr << "Error: --shard-dir may not be used with the "
+                  << config.drivers[0].driver->name << " driver" << std::endl;
+        exit(1);
+    }
+
+    if(!config.shard_dir.empty() && (!config.symbols.empty() || config.type_table)) {
+        std::cerr << "Error: --shard-dir may not be used with --symbols or --type-table"
+                  << std::endl;
+        exit(1);
+    }
+
+    if(!config.batch_file.empty() && !config.serve_socket.empty()) {
+        std::cerr << "Error: --batch and --serve are mutually exclusive" << std::endl;
+        exit(1);
+    }
+
+    if(!config.time_trace.empty() && !config.serve_socket.empty()) {
+        std::cerr << "Error: --time-trace may not be used with --serve" << std::endl;
+        exit(1);
+    }
+
+    if(!config.emit_pch.empty() &&
+       (!config.batch_file.empty() || !config.serve_socket.empty())) {
+        std::cerr << "Error: --emit-pch may not be used with --batch or --serve"
+                  << std::endl;
+        exit(1);
+    }
+
+    if(!config.batch_file.empty() || !config.serve_socket.empty()) {
+        const char *mode = config.batch_file.empty() ? "--serve" : "--batch";
+
+        if(optind < argc || config.read_stdin) {
+            std::cerr << "Error: FILE may not be specified with " << mode << std::endl;
+            exit(1);
+        }
+
+        if(output_specified || config.macro_output || config.template_output ||
+           config.preprocess_only || !config.depfile.empty()) {
+            std::cerr << "Error: -o, -M, -T, -E and --depfile may not be used with "
+                      << mode << std::endl;
+            exit(1);
+        }
+
+        if(config.drivers.size() > 1 || !config.drivers[0].path.empty()) {
+            std::cerr << "Error: -D driver:path may not be used with " << mode
+                      << std::endl;
+            exit(1);
+        }
+
+        return;
+    }
+
+    if(optind < argc && std::string(argv[optind]) == "-") {
+        optind++;
+        config.read_stdin = true;
+    }
+
+    if(config.read_stdin) {
+        if(optind < argc) {
+            std::cerr << "Error: FILE may not be specified with --stdin-name"
+                      << std::endl;
+            exit(1);
+        }
+
+        if(!config.emit_pch.empty()) {
+            std::cerr << "Error: --emit-pch can't read from stdin" << std::endl;
+            exit(1);
+        }
+
+        // Nothing to go on but the name given, if any
+        if(config.filename.empty()) {
+            config.filename = "<stdin>";
+            if(config.lang.empty()) config.lang = "c";
+        }
+
+        std::ostringstream ss;
+        ss << std::cin.rdbuf();
+        config.input_data = ss.str();
+    } else if(optind >= argc) {
         std::cerr << "Error: No file specified." << std::endl;
         usage();
         exit(1);
@@ -235,7 +510,9 @@ void c2ffi::process_args(config &config, int argc, char *argv[]) {
     }
 
     struct stat buf;
-    if(stat(config.filename.c_str(), &buf) < 0) {
+    if(config.read_stdin) {
+        // The contents are never looked for on disk
+    } else if(stat(config.filename.c_str(), &buf) < 0) {
         std::cerr << "Error: No such file: " << config.filename
                   << std::endl;
         exit(1);
@@ -245,12 +522,36 @@ void c2ffi::process_args(config &config, int argc, char *argv[]) {
         exit(1);
     }
 
+    if(!config.depfile.empty() && config.dep_targets.empty()) {
+        // --emit-pch writes nothing else
+        if(!config.emit_pch.empty()) outputs.assign(1, config.emit_pch);
+        config.dep_targets = outputs;
+
+        if(outputs.empty()) {
+            std::cerr << "Error: --depfile needs an output file or --dep-target"
+                      << std::endl;
+            exit(1);
+        }
+    }
+
+    // Opened last, once --async-output is known
+    if(output_specified) {
+        os = FdStream::open(output_path, config.async_output);
+
+        if(!os) {
+            std::cerr << "Error: Could not open output file: " << output_path
+                      << std::endl;
+            exit(1);
+        }
+    } else {
+        os = new FdStream(STDOUT_FILENO, false, config.async_output);
+    }
+
     config.output = os;
+    config.od = make_output_driver(config.drivers, os, config.async_output);
 
     if(!config.od)
-        config.od = OutputDrivers[0].fn(os);
-    else
-        config.od->set_os(os);
+        exit(1);
 }
 
 void usage(void) {
@@ -259,6 +560,9 @@ void usage(void) {
 
     cout <<
         "Usage: c2ffi [options ...] FILE\n"
+        "       c2ffi [options ...] -           (read FILE from stdin)\n"
+        "       c2ffi [options ...] --batch LIST\n"
+        "       c2ffi [options ...] --serve SOCKET\n"
         "\n"
         "Options:\n"
         "      -I, --include        Add a \"LOCAL\" include path\n"
@@ -266,10 +570,31 @@ void usage(void) {
         "      --nostdinc           Disable standard include path\n"
         "      -D, --driver         Specify an output driver (default: "
          << OutputDrivers[0].name << ")\n"
+        "                           DRIVER:PATH writes that driver's output to\n"
+        "                           PATH; may be repeated to share one parse\n"
         "\n"
         "      -o, --output         Specify an output file (default: stdout)\n"
+        "      --async-output       Write output from a separate thread, so parsing\n"
+        "                           never waits on the disk\n"
+        "      --stdin-name=NAME    Read FILE from stdin, calling it NAME\n"
+        "                           (default: <stdin>, in C)\n"
         "      -M, --macro-file     Specify a file for macro definition output\n"
         "      --with-macro-defs    Also include #defines for macro definitions\n"
+        "      --macro-values       Output macro constants as __c2ffi_NAME variables\n"
+        "                           from this parse, instead of a -M second run\n"
+        "      --only-from=GLOB     Only output decls and macros from matching files\n"
+        "      --exclude-from=GLOB  Leave out decls and macros from matching files\n"
+        "      --main-only          Only output decls and macros from FILE itself\n"
+        "                           (with --only-from, from either)\n"
+        "      --symbols=REGEX|FILE Only output matching decls and macros, and the\n"
+        "                           decls they refer to; FILE has a REGEX per line\n"
+        "      --type-table         Output each type once, with an id, and refer to\n"
+        "                           it by id everywhere it's used\n"
+        "      --batch LIST         Process each \"INPUT [OUTPUT]\" line of LIST in\n"
+        "                           one process (default OUTPUT: INPUT.<driver>)\n"
+        "      -j, --jobs N         Parse N --batch inputs in parallel (0: one per CPU)\n"
+        "      --serve SOCKET       Answer requests on a Unix socket, keeping\n"
+        "                           caches warm between them (see README)\n"
         "\n"
         "      -N, --namespace      Specify target namespace/package/etc\n"
         "\n"
@@ -279,8 +604,23 @@ void usage(void) {
         "      -x, --lang           Specify language (c, c++, objc, objc++)\n"
         "      --std                Specify the standard (c99, c++0x, c++11, ...)\n"
         "      --wchar-size=N       Specify wchar_t size (N must be 1, 2, or 4)\n"
+        "      --skip-function-bodies\n"
+        "                           Don't parse function bodies (faster for C++)\n"
         "\n"
         "      -E                   Preprocessed output only, a la clang -E\n"
+        "      --emit-pch=PCH       Write a precompiled header for FILE to PCH and exit\n"
+        "      --include-pch=PCH    Load PCH before FILE; its decls are output first\n"
+        "      --cache-dir=DIR      Reuse output cached in DIR while FILE and every\n"
+        "                           header it read are unchanged\n"
+        "      --shard-dir=DIR      Reuse the output for each header cached in DIR\n"
+        "                           by runs which included it the same way\n"
+        "      --depfile=FILE       Write a Make-style depfile listing every file read\n"
+        "      --dep-target=NAME    Target for --depfile (default: all output files)\n"
+        "      --stats[=FORMAT]     Report time and memory per phase on stderr\n"
+        "                           (FORMAT: text or json, default: text)\n"
+        "      --time-trace=FILE    Write a Chrome trace of clang and c2ffi to FILE\n"
+        "      --time-trace-granularity=N\n"
+        "                           Leave out events under N us (default: 500)\n"
         "\n"
         "      --declspec           Enable support for Microsoft __declspec extension\n"
         "      --fail-on-error      Fail command if any compilation error occurs\n"
@@ -299,16 +639,12 @@ void usage(void) {
     cout << endl;
 }
 
-c2ffi::OutputDriver* select_driver(std::string name, std::ostream *os) {
+const c2ffi::OutputDriverField* select_driver(std::string name) {
     using namespace c2ffi;
     using namespace std;
 
-    for(int i = 0;; i++) {
-        if(!OutputDrivers[i].name) break;
-
-        if(name == OutputDrivers[i].name)
-            return OutputDrivers[i].fn(os);
-    }
+    if(const OutputDriverField *driver = find_output_driver(name))
+        return driver;
 
     cerr << "Error: Invalid output driver: " << name << endl;
     usage();
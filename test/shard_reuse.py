@@ -0,0 +1,149 @@
+#!/usr/bin/env python3
+#
+#   c2ffi
+#   Copyright (C) 2013  Ryan Pavlik
+#
+#   This file is part of c2ffi.
+#
+#   c2ffi is free software: you can redistribute it and/or modify
+#   it under the terms of the GNU General Public License as published by
+#   the Free Software Foundation, either version 2 of the License, or
+#   (at your option) any later version.
+#
+#   c2ffi is distributed in the hope that it will be useful,
+#   but WITHOUT ANY WARRANTY; without even the implied warranty of
+#   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#   GNU General Public License for more details.
+#
+#   You should have received a copy of the GNU General Public License
+#   along with c2ffi.  If not, see <http://www.gnu.org/licenses/>.
+
+"""Check when --shard-dir reuses a header's shard under a different main file.
+
+Two main files which include the same header first must share its
+shard: converting the second writes no new shard.  Two main files
+which define a type the header uses differently before including it
+must not: the second gets its own shard.  Either way, output must
+match a run without --shard-dir.
+"""
+
+import argparse
+import os
+import subprocess
+import sys
+import tempfile
+
+COMMON_H = """\
+#define COMMON_SIZE 4
+struct common { int a[COMMON_SIZE]; struct { int x, y; } pos; };
+typedef struct common common_t;
+int common_init(common_t *c);
+"""
+
+MAIN1_H = """\
+#include "common.h"
+struct one { common_t c; };
+"""
+
+MAIN2_H = """\
+#include "common.h"
+int two(common_t *c, int n);
+"""
+
+LAYOUT_H = """\
+struct T { struct S s; int b; };
+"""
+
+LAYOUT1_H = """\
+struct S { int a; };
+#include "layout.h"
+"""
+
+LAYOUT2_H = """\
+struct S { double a[4]; };
+#include "layout.h"
+"""
+
+
+def write(path, text):
+    with open(path, "w") as f:
+        f.write(text)
+
+
+def read(path):
+    with open(path) as f:
+        return f.read()
+
+
+def shards(shard_dir):
+    """Map each shard file under shard_dir to its contents."""
+    found = {}
+    for root, _, files in os.walk(shard_dir):
+        for name in files:
+            path = os.path.join(root, name)
+            with open(path, "rb") as f:
+                found[path] = f.read()
+    return found
+
+
+def convert(c2ffi, main, out, extra=()):
+    subprocess.run([c2ffi, "-x", "c", "-D", "json", "-o", out] + list(extra) + [main], check=True)
+    return read(out)
+
+
+def check(c2ffi, tmp, first, second, reuse):
+    """Convert first then second with a fresh shard dir; return an error or None."""
+    shard_dir = os.path.join(tmp, "shards-" + os.path.basename(second))
+    out = os.path.join(tmp, "out.json")
+
+    convert(c2ffi, first, out, ["--shard-dir", shard_dir])
+    before = shards(shard_dir)
+
+    if not before:
+        return "no shards written for " + os.path.basename(first)
+
+    sharded = convert(c2ffi, second, out, ["--shard-dir", shard_dir])
+    after = shards(shard_dir)
+
+    if reuse and after != before:
+        return os.path.basename(second) + " did not reuse the shard"
+    if not reuse and set(after) == set(before):
+        return os.path.basename(second) + " reused a shard made for a different includer"
+
+    if sharded != convert(c2ffi, second, out):
+        return "output of " + os.path.basename(second) + " with --shard-dir differs from without"
+
+    return None
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--c2ffi", default="c2ffi", help="c2ffi executable")
+    args = parser.parse_args()
+
+    with tempfile.TemporaryDirectory() as tmp:
+        files = {
+            "common.h": COMMON_H, "main1.h": MAIN1_H, "main2.h": MAIN2_H,
+            "layout.h": LAYOUT_H, "layout1.h": LAYOUT1_H, "layout2.h": LAYOUT2_H,
+        }
+        for name, text in files.items():
+            write(os.path.join(tmp, name), text)
+
+        cases = [
+            ("main1.h", "main2.h", True),
+            ("layout1.h", "layout2.h", False),
+        ]
+
+        for first, second, reuse in cases:
+            error = check(args.c2ffi, tmp, os.path.join(tmp, first), os.path.join(tmp, second), reuse)
+            if error:
+                print("FAIL: " + error)
+                return 1
+
+    print("ok")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())